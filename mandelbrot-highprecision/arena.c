@@ -0,0 +1,132 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Functions: arenaInstall, arenaRelease
+ * -------------------------------------------------------------------------------------------------
+ * These functions replace GMP's use of malloc, realloc and free with a pool arena, installed with
+ * mp_set_memory_functions. GMP limb buffers of an mpf_t all have the same few sizes, and GMP passes
+ * the size of a block back when it frees it, so blocks are kept in free lists by size class and
+ * handed out again without a call to malloc. New blocks are cut one after the other from large
+ * chunks, so values initialized together sit next to each other in memory.
+ *
+ * Blocks larger than ARENA_MAXBLOCK go straight to malloc. The arena state is per thread, so
+ * threads never share a free list. arenaInstall must be called before the first GMP allocation,
+ * and arenaRelease returns every chunk of the calling thread once GMP is no longer used.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <gmp.h>
+#include <mpi.h>
+
+#include "julia.h"
+
+// Blocks are rounded up to a multiple of ARENA_ALIGN bytes
+#define ARENA_ALIGN 16
+
+// Largest block served from the arena
+#define ARENA_MAXBLOCK 4096
+
+// Number of size classes
+#define ARENA_CLASSES (ARENA_MAXBLOCK / ARENA_ALIGN + 1)
+
+// Default chunk size
+#define ARENA_CHUNK (1 << 20)
+
+/* A free block holds the next free block of its size class */
+typedef struct FreeBlock
+{
+  struct FreeBlock *next;
+} FreeBlock;
+
+/* Chunks are chained through their first bytes so they can be released */
+typedef struct Chunk
+{
+  struct Chunk *next;
+} Chunk;
+
+static __thread FreeBlock *freeLists[ARENA_CLASSES];
+static __thread Chunk *chunks = NULL;
+static __thread char *bump = NULL;
+static __thread char *bumpEnd = NULL;
+static size_t chunkSize = ARENA_CHUNK;
+
+static void *arenaAlloc(size_t size)
+{
+  if (size > ARENA_MAXBLOCK) return malloc(size);
+
+  size_t c = (size + ARENA_ALIGN - 1) / ARENA_ALIGN;
+  FreeBlock *block = freeLists[c];
+
+  // Reuse a freed block of the same class
+  if (block != NULL)
+  {
+    freeLists[c] = block->next;
+    return block;
+  }
+
+  // Cut a new block from the current chunk, starting a new chunk if it is full
+  size_t bytes = c * ARENA_ALIGN;
+  if (bump == NULL || bump + bytes > bumpEnd)
+  {
+    Chunk *chunk = (Chunk*)malloc(chunkSize);
+    assert(chunk != NULL);
+    chunk->next = chunks;
+    chunks = chunk;
+    bump = (char*)chunk + ARENA_ALIGN;
+    bumpEnd = (char*)chunk + chunkSize;
+  }
+
+  void *p = bump;
+  bump += bytes;
+  return p;
+}
+
+static void arenaFree(void *p, size_t size)
+{
+  if (size > ARENA_MAXBLOCK)
+  {
+    free(p);
+    return;
+  }
+
+  size_t c = (size + ARENA_ALIGN - 1) / ARENA_ALIGN;
+  FreeBlock *block = (FreeBlock*)p;
+  block->next = freeLists[c];
+  freeLists[c] = block;
+}
+
+static void *arenaRealloc(void *p, size_t oldSize, size_t newSize)
+{
+  // Still the same block
+  if (oldSize <= ARENA_MAXBLOCK && newSize <= ARENA_MAXBLOCK &&
+      (oldSize + ARENA_ALIGN - 1) / ARENA_ALIGN == (newSize + ARENA_ALIGN - 1) / ARENA_ALIGN)
+    return p;
+
+  if (oldSize > ARENA_MAXBLOCK && newSize > ARENA_MAXBLOCK) return realloc(p, newSize);
+
+  void *q = arenaAlloc(newSize);
+  memcpy(q, p, (oldSize < newSize) ? oldSize : newSize);
+  arenaFree(p, oldSize);
+  return q;
+}
+
+void arenaInstall(size_t bytes)
+{
+  if (bytes > ARENA_MAXBLOCK) chunkSize = bytes;
+  mp_set_memory_functions(arenaAlloc, arenaRealloc, arenaFree);
+}
+
+void arenaRelease()
+{
+  while (chunks != NULL)
+  {
+    Chunk *next = chunks->next;
+    free(chunks);
+    chunks = next;
+  }
+
+  memset(freeLists, 0, sizeof(freeLists));
+  bump = bumpEnd = NULL;
+}
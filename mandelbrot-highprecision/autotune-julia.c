@@ -0,0 +1,299 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: autotuneJulia
+ * Inputs: mpf_t xmin, xmax - x coordinates
+ *         unsigned long int xres - the width of the complete image
+ *         mpf_t ymin, ymax - y coordinates
+ *         unsigned long int yres - the height of the complete image
+ *         mpf_t cr, ci - values of the imaginary number c + ci
+ *         int flag - indicates if the image is Mandelbrot or Julia set
+ *         int maxIterations - maximum number of hops to try to exit the unit circle
+ *         JuliaOptions *options - command line options; a strategy or chunk given there is kept
+ *         int *strategy - returns the chosen STRATEGY_* value
+ *         long int *chunkRows - returns the chosen number of rows per task
+ *         int my_rank - the id of the current process
+ *         int p - the total number of processes running
+ *         MPI_Comm comm - the MPI communicator of the program
+ * -------------------------------------------------------------------------------------------------
+ * This function chooses the distribution strategy and the rows per task (the tile height; tiles
+ * are always full rows) for this render instead of deciding from the number of processes alone.
+ *
+ * It first runs a short calibration. The processes share the timing of a sample of small tiles,
+ * one per sampled row, spread over the view at the render precision. Process 0 and the last
+ * process then time a ping-pong of one int and of one row to estimate latency and bandwidth.
+ *
+ * A cost model predicts the run time of every strategy for every power of two chunk size:
+ *  - serial:       all rows on one process
+ *  - block:        the most expensive block of rows plus gathering the image
+ *  - master:       the larger of the p-1 slaves' work and the master's message handling
+ *  - hierarchical: p processes' work plus the per chunk wait on each node and forwarding
+ * Every row also carries the tail of one task, so chunks that are too large are penalised.
+ * The predictions and the choice are printed by process 0.
+ *
+ * With -profile <file> the decision is looked up in, or appended to, a text file of decisions for
+ * this machine, keyed by process count, node count, resolution, maxiter, flag and precision.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <gmp.h>
+#include <mpi.h>
+
+#include "julia.h"
+
+// Calibration sample: at most TUNEROWS rows, each with one tile of at most TUNEWIDTH pixels
+#define TUNEROWS 64
+#define TUNEWIDTH 32
+
+// Ping-pong repetitions
+#define PINGS 20
+
+#define TYPEPING 10
+
+static const char *strategyNames[] = {"auto", "serial", "block", "master", "hierarchical"};
+
+/* Look up a saved decision; returns 1 if one was found */
+static int readProfile(char *filename, int p, int nodes, unsigned long int xres, unsigned long int yres, int maxIterations, int flag, long int precision,
+		       int *strategy, long int *chunkRows)
+{
+  FILE *f = fopen(filename, "r");
+  char line[256], name[32];
+  int fp, fnodes, fmax, fflag, s, found = 0;
+  unsigned long int fx, fy;
+  long int fprec, chunk;
+
+  if (f == NULL) return 0;
+
+  while (!found && fgets(line, sizeof(line), f) != NULL)
+  {
+    if (sscanf(line, "%d %d %lu %lu %d %d %ld %31s %ld", &fp, &fnodes, &fx, &fy, &fmax, &fflag, &fprec, name, &chunk) != 9) continue;
+    if (fp != p || fnodes != nodes || fx != xres || fy != yres || fmax != maxIterations || fflag != flag || fprec != precision) continue;
+
+    for (s = STRATEGY_SERIAL; s <= STRATEGY_HIERARCHICAL; s++)
+      if (strcmp(name, strategyNames[s]) == 0)
+      {
+        *strategy = s;
+        *chunkRows = chunk;
+        found = 1;
+      }
+  }
+
+  fclose(f);
+  return found;
+}
+
+/* Predicted run time of a strategy with a given chunk size */
+static double predict(int strategy, long int chunk, double *rowCost, int *sampleRow, int samples, double meanRow, double maxRow,
+		      unsigned long int xres, unsigned long int yres, double latency, double byteTime, int p, int nodes)
+{
+  double total = meanRow * yres;
+  double rowBytes = sizeof(int) * (double)xres;
+  double tasks = ceil((double)yres / chunk);
+  int b, s;
+
+  if (strategy == STRATEGY_SERIAL) return total;
+
+  if (strategy == STRATEGY_BLOCK)
+  {
+    // Cost of the most expensive block, estimated from the samples that fall inside it
+    double worst = 0;
+    long int start = 0;
+    for (b = 0; b < p; b++)
+    {
+      long int rows = yres / p + ((b < yres % p) ? 1 : 0);
+      double sum = 0;
+      int n = 0;
+      for (s = 0; s < samples; s++)
+        if (sampleRow[s] >= start && sampleRow[s] < start + rows)
+        {
+          sum += rowCost[s];
+          n++;
+        }
+      double cost = rows * ((n > 0) ? sum / n : meanRow);
+      if (cost > worst) worst = cost;
+      start += rows;
+    }
+    return worst + latency + rowBytes * yres * byteTime;
+  }
+
+  if (strategy == STRATEGY_MASTER)
+  {
+    double perTask = 2 * latency + chunk * rowBytes * byteTime;
+    double master = tasks * perTask;
+    double slaves = total / (p - 1) + chunk * maxRow;
+    return ((master > slaves) ? master : slaves) + perTask;
+  }
+
+  // Hierarchical: every process computes; each chunk ends with a node barrier and one forward
+  double nodeSize = (double)p / nodes;
+  double chunksPerNode = tasks / nodes;
+  double perChunk = meanRow / 2 + 3 * latency + chunk * rowBytes * byteTime;
+  return total / p + chunksPerNode * perChunk + chunk * maxRow / nodeSize;
+}
+
+void autotuneJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci,
+	  int flag, int maxIterations, JuliaOptions *options, int *strategy, long int *chunkRows, int my_rank, int p, MPI_Comm comm)
+{
+  int nodes = countNodes(comm);
+  long int precision = mpf_get_prec(xmax);
+  int found = 0;
+  int s, i;
+
+  // Fallback if no candidate can run, e.g. a forced master on one process
+  *strategy = (options->strategy != STRATEGY_AUTO) ? options->strategy : STRATEGY_SERIAL;
+  *chunkRows = (options->chunkRows > 0) ? options->chunkRows : 1;
+
+  // Try the saved decisions first
+  if (my_rank == 0 && options->profile != NULL)
+    found = readProfile(options->profile, p, nodes, xres, yres, maxIterations, flag, precision, strategy, chunkRows);
+  MPI_Bcast(&found, 1, MPI_INT, 0, comm);
+
+  if (found)
+  {
+    MPI_Bcast(strategy, 1, MPI_INT, 0, comm);
+    MPI_Bcast(chunkRows, 1, MPI_LONG, 0, comm);
+    if (my_rank == 0) printf("Autotune: using saved decision from %s\n", options->profile);
+
+    // Command line choices still win over the saved ones
+    if (options->strategy != STRATEGY_AUTO) *strategy = options->strategy;
+    if (options->chunkRows > 0) *chunkRows = options->chunkRows;
+  }
+  else
+  {
+    double t1, t2;
+
+    // Calibration sample: tile s sits in row sampleRow[s], staggered across the width
+    int samples = (yres < TUNEROWS) ? yres : TUNEROWS;
+    unsigned long int tileWidth = xres / TUNEROWS;
+    if (tileWidth < 1) tileWidth = 1;
+    if (tileWidth > TUNEWIDTH) tileWidth = TUNEWIDTH;
+
+    double *local = (double*)calloc(samples, sizeof(double));
+    double *rowCost = (double*)malloc(sizeof(double) * samples);
+    int *sampleRow = (int*)malloc(sizeof(int) * samples);
+    int *tile = (int*)malloc(sizeof(int) * tileWidth);
+    assert(local != NULL && rowCost != NULL && sampleRow != NULL && tile != NULL);
+
+    for (s = 0; s < samples; s++)
+    {
+      sampleRow[s] = ((2 * s + 1) * yres) / (2 * samples);
+      if (s % p != my_rank) continue;
+
+      unsigned long int startx = (unsigned long int)(fmod(s * 0.6180339887, 1.0) * (xres - tileWidth + 1));
+      t1 = MPI_Wtime();
+      julia(xmin, xmax, tileWidth, xres, startx, ymin, ymax, 1, yres, sampleRow[s], cr, ci, flag, maxIterations, tile, NULL);
+      t2 = MPI_Wtime();
+
+      // Scale the tile to a full row
+      local[s] = (t2 - t1) * xres / tileWidth;
+    }
+    MPI_Allreduce(local, rowCost, samples, MPI_DOUBLE, MPI_SUM, comm);
+
+    // Ping-pong between the first and the last process
+    double latency = 0, byteTime = 0;
+    if (p > 1 && (my_rank == 0 || my_rank == p - 1))
+    {
+      int *msg = (int*)calloc(xres, sizeof(int));
+      int partner = (my_rank == 0) ? p - 1 : 0;
+      int size, k;
+      double small = 0;
+      assert(msg != NULL);
+
+      for (size = 1; size <= 2; size++)
+      {
+        int count = (size == 1) ? 1 : xres;
+        t1 = MPI_Wtime();
+        for (k = 0; k < PINGS; k++)
+        {
+          if (my_rank == 0)
+          {
+            MPI_Send(msg, count, MPI_INT, partner, TYPEPING, comm);
+            MPI_Recv(msg, count, MPI_INT, partner, TYPEPING, comm, MPI_STATUS_IGNORE);
+          }
+          else
+          {
+            MPI_Recv(msg, count, MPI_INT, partner, TYPEPING, comm, MPI_STATUS_IGNORE);
+            MPI_Send(msg, count, MPI_INT, partner, TYPEPING, comm);
+          }
+        }
+        t2 = MPI_Wtime();
+
+        if (size == 1) small = (t2 - t1) / (2 * PINGS);
+        else byteTime = ((t2 - t1) / (2 * PINGS) - small) / (sizeof(int) * (double)xres);
+      }
+      latency = small;
+      if (byteTime < 0) byteTime = 0;
+      free(msg);
+    }
+
+    if (my_rank == 0)
+    {
+      double meanRow = 0, maxRow = 0, best = -1, t;
+      long int chunk, first, last;
+      int strategies[4] = {STRATEGY_SERIAL, STRATEGY_BLOCK, STRATEGY_MASTER, STRATEGY_HIERARCHICAL};
+
+      for (s = 0; s < samples; s++)
+      {
+        meanRow += rowCost[s] / samples;
+        if (rowCost[s] > maxRow) maxRow = rowCost[s];
+      }
+
+      printf("Autotune: row cost mean %g s, max %g s; latency %g us, %g MB/s\n", meanRow, maxRow, latency * 1e6,
+	     (byteTime > 0) ? 1e-6 / byteTime : 0.0);
+
+      for (i = 0; i < 4; i++)
+      {
+        s = strategies[i];
+
+        // Only consider what can run here and what was not fixed on the command line
+        if (options->strategy != STRATEGY_AUTO && s != options->strategy) continue;
+        if ((s == STRATEGY_SERIAL) != (p == 1) && options->strategy == STRATEGY_AUTO) continue;
+        if (s == STRATEGY_MASTER && p < 2) continue;
+
+        first = 1;
+        last = yres / p;
+        if (last < 1) last = 1;
+        if (s == STRATEGY_SERIAL || s == STRATEGY_BLOCK) last = 1;
+        if (options->chunkRows > 0) first = last = options->chunkRows;
+
+        for (chunk = first; chunk <= last; chunk *= 2)
+        {
+          t = predict(s, chunk, rowCost, sampleRow, samples, meanRow, maxRow, xres, yres, latency, byteTime, p, nodes);
+          printf("Autotune: %-12s %6ld rows per task  predicted %g s\n", strategyNames[s], chunk, t);
+          if (best < 0 || t < best)
+          {
+            best = t;
+            *strategy = s;
+            *chunkRows = chunk;
+          }
+        }
+      }
+
+      // Remember the decision for the next run on this machine
+      if (options->profile != NULL)
+      {
+        FILE *f = fopen(options->profile, "a");
+        if (f != NULL)
+        {
+          fprintf(f, "%d %d %lu %lu %d %d %ld %s %ld\n", p, nodes, xres, yres, maxIterations, flag, precision, strategyNames[*strategy], *chunkRows);
+          fclose(f);
+        }
+        else perror("Error opening profile\n");
+      }
+    }
+
+    MPI_Bcast(strategy, 1, MPI_INT, 0, comm);
+    MPI_Bcast(chunkRows, 1, MPI_LONG, 0, comm);
+
+    free(local);
+    free(rowCost);
+    free(sampleRow);
+    free(tile);
+  }
+
+  if (my_rank == 0)
+    printf("Autotune: chose %s with %ld rows per task (tiles of %ld rows x %lu columns)\n", strategyNames[*strategy], *chunkRows, *chunkRows, xres);
+}
@@ -0,0 +1,454 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: EscalateJulia
+ * Inputs: mpf_t xmin, xmax - x coordinates
+ *         unsigned long int xres - the width of the complete image
+ *         mpf_t ymin, ymax - y coordinates
+ *         unsigned long int yres - the height of the complete image
+ *         mpf_t cr, ci - values of the imaginary number c + ci
+ *         int flag - indicates if the image is Mandelbrot or Julia set
+ *         int maxIterations - the largest iteration budget any pass may use
+ *         int *iterations - the complete image; only filled on process 0
+ *         float *smooth - smooth escape values of the complete image; NULL if not wanted
+ *         int budget - the iteration budget of the first pass
+ *         long int threshold - stop once a pass resolves fewer pixels than this
+ *         int my_rank - the id of the current process
+ *         int p - the total number of processes running
+ *         MPI_Comm comm - the MPI communicator of the program
+ * Outputs: long int totalCount - the number of iterations performed by the process
+ * -------------------------------------------------------------------------------------------------
+ * This function renders the image in passes of growing iteration budgets instead of running every
+ * pixel to maxIterations.
+ *
+ * The first pass gives each process an even block of rows and runs it with the starting budget.
+ * A pixel that has not escaped keeps its z value, at the full precision of the kernel, in a packed
+ * record. Each following pass doubles the budget (up to maxIterations) and continues only those
+ * records from where they stopped, so no iteration is ever repeated. Between passes the records
+ * are redistributed evenly across the processes with MPI_Alltoallv, because the unresolved pixels
+ * tend to sit in a few blocks of rows.
+ *
+ * Passes stop when a pass resolves fewer than threshold pixels, when every pixel has escaped or
+ * when the budget reaches maxIterations. Pixels still unresolved then are stored as maxIterations,
+ * so running up to maxIterations gives exactly the image a single pass would give.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <assert.h>
+#include <gmp.h>
+#include <mpi.h>
+
+#include "julia.h"
+
+// Booleans
+#define FALSE 0
+#define TRUE 1
+
+// Initial size of the growable pixel lists
+#define INITIALSIZE 1024
+
+/* Scratch values of the pixel kernel, initialized once for all pixels */
+typedef struct
+{
+  mpf_t xgap, ygap;
+  mpf_t zinitReal, zinitImag;
+  mpf_t z0Real, z0Imag;
+  mpf_t zReal, zImag;
+  mpf_t tempReal, tempImag;
+  mpf_t magnitude;
+  int limbs;                    // limbs needed to store zReal or zImag exactly
+} Kernel;
+
+/* Pixels that escaped, waiting to be sent to process 0 */
+typedef struct
+{
+  long int *pixel;
+  int *iteration;
+  float *smooth;
+  long int count, size;
+} EscapedList;
+
+/*
+ * An mpf_t is stored in a record as its size and exponent followed by its limbs, see the GMP
+ * manual chapter on internals. Unpacking into an mpf_t of the same precision gives back exactly
+ * the same number, so a resumed orbit continues bit for bit where it stopped.
+*/
+static size_t mpfSlotSize(int limbs)
+{
+  return sizeof(long int) * 2 + sizeof(mp_limb_t) * limbs;
+}
+
+static void packMpf(unsigned char *slot, mpf_t x)
+{
+  long int *header = (long int*)slot;
+  header[0] = x->_mp_size;
+  header[1] = x->_mp_exp;
+  memcpy(header + 2, x->_mp_d, sizeof(mp_limb_t) * labs(header[0]));
+}
+
+static void unpackMpf(mpf_t x, unsigned char *slot)
+{
+  long int *header = (long int*)slot;
+  x->_mp_size = header[0];
+  x->_mp_exp = header[1];
+  memcpy(x->_mp_d, header + 2, sizeof(mp_limb_t) * labs(header[0]));
+}
+
+/* Record layout: pixel index, iterations so far, zReal, zImag */
+static size_t recordSize(Kernel *k)
+{
+  return sizeof(long int) * 2 + 2 * mpfSlotSize(k->limbs);
+}
+
+static void kernelInit(Kernel *k, mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres)
+{
+  mpf_init(k->xgap);
+  mpf_init(k->ygap);
+  mpf_init(k->zinitReal);
+  mpf_init(k->zinitImag);
+  mpf_init(k->z0Real);
+  mpf_init(k->z0Imag);
+  mpf_init(k->zReal);
+  mpf_init(k->zImag);
+  mpf_init(k->tempReal);
+  mpf_init(k->tempImag);
+  mpf_init(k->magnitude);
+
+  // An mpf_t holds at most _mp_prec + 1 limbs
+  k->limbs = k->zReal->_mp_prec + 1;
+
+  mpf_sub(k->xgap, xmax, xmin);    // xgap = (x[1] - x[0]) / xres;
+  mpf_div_ui(k->xgap, k->xgap, xres);
+
+  mpf_sub(k->ygap, ymax, ymin);    // ygap = (y[1] - y[0]) / yres;
+  mpf_div_ui(k->ygap, k->ygap, yres);
+}
+
+static void kernelClear(Kernel *k)
+{
+  mpf_clear(k->xgap);
+  mpf_clear(k->ygap);
+  mpf_clear(k->zinitReal);
+  mpf_clear(k->zinitImag);
+  mpf_clear(k->z0Real);
+  mpf_clear(k->z0Imag);
+  mpf_clear(k->zReal);
+  mpf_clear(k->zImag);
+  mpf_clear(k->tempReal);
+  mpf_clear(k->tempImag);
+  mpf_clear(k->magnitude);
+}
+
+/*
+ * Iterate one pixel from iteration up to budget, with the same arithmetic as julia. If resume is
+ * set, z is already loaded in k->zReal and k->zImag, otherwise the orbit starts at the pixel.
+ * Returns the iteration reached; *escaped tells if the pixel left the circle.
+*/
+static int iteratePixel(Kernel *k, mpf_t xmin, mpf_t ymin, unsigned long int xres, mpf_t cr, mpf_t ci, int flag,
+			long int pixel, int iteration, int budget, int resume, int *escaped, float *smoothValue)
+{
+  const double maxRadius = 2.0;
+  int compare;
+
+  /* pixel to coordinates, base values for sets */
+  mpf_mul_ui(k->tempReal, k->xgap, pixel % xres);
+  mpf_add(k->zinitReal, xmin, k->tempReal);
+
+  mpf_mul_ui(k->tempImag, k->ygap, pixel / xres);
+  mpf_add(k->zinitImag, ymin, k->tempImag);
+
+  /* if flag=0, z = z0, flag=1, z = C */
+  mpf_mul_ui(k->tempReal, cr, flag);
+  mpf_mul_ui(k->tempImag, k->zinitReal, (1-flag));
+  mpf_add(k->z0Real, k->tempReal, k->tempImag);
+
+  mpf_mul_ui(k->tempReal, ci, flag);
+  mpf_mul_ui(k->tempImag, k->zinitImag, (1-flag));
+  mpf_add(k->z0Imag, k->tempReal, k->tempImag);
+
+  if (!resume)
+  {
+    mpf_set(k->zReal, k->zinitReal);
+    mpf_set(k->zImag, k->zinitImag);
+  }
+
+  mpf_mul(k->tempReal, k->zReal, k->zReal);
+  mpf_mul(k->tempImag, k->zImag, k->zImag);
+  mpf_add(k->magnitude, k->tempReal, k->tempImag);
+  compare = mpf_cmp_d(k->magnitude, (maxRadius*maxRadius));
+
+  while (compare < 0 && iteration < budget)
+  {
+    iteration++;
+
+    mpf_mul(k->tempReal, k->zReal, k->zReal);
+    mpf_mul(k->tempImag, k->zImag, k->zImag);
+    mpf_sub(k->tempReal, k->tempReal, k->tempImag);
+
+    mpf_mul_ui(k->tempImag, k->zReal, 2);
+    mpf_mul(k->tempImag, k->tempImag, k->zImag);
+
+    mpf_add(k->zReal, k->tempReal, k->z0Real);
+    mpf_add(k->zImag, k->tempImag, k->z0Imag);
+
+    mpf_mul(k->tempReal, k->zReal, k->zReal);
+    mpf_mul(k->tempImag, k->zImag, k->zImag);
+    mpf_add(k->magnitude, k->tempReal, k->tempImag);
+    compare = mpf_cmp_d(k->magnitude, (maxRadius*maxRadius));
+  }
+
+  *escaped = (compare >= 0);
+  if (*escaped) *smoothValue = iteration + 1 - log2(0.5 * log(mpf_get_d(k->magnitude)));
+
+  return iteration;
+}
+
+static void addEscaped(EscapedList *list, long int pixel, int iteration, float smoothValue)
+{
+  if (list->count == list->size)
+  {
+    list->size *= 2;
+    list->pixel = (long int*)realloc(list->pixel, sizeof(long int) * list->size);
+    list->iteration = (int*)realloc(list->iteration, sizeof(int) * list->size);
+    list->smooth = (float*)realloc(list->smooth, sizeof(float) * list->size);
+    assert(list->pixel != NULL && list->iteration != NULL && list->smooth != NULL);
+  }
+
+  list->pixel[list->count] = pixel;
+  list->iteration[list->count] = iteration;
+  list->smooth[list->count] = smoothValue;
+  list->count++;
+}
+
+static void writeRecord(Kernel *k, unsigned char *record, long int pixel, int iteration)
+{
+  long int *header = (long int*)record;
+  header[0] = pixel;
+  header[1] = iteration;
+  packMpf(record + sizeof(long int) * 2, k->zReal);
+  packMpf(record + sizeof(long int) * 2 + mpfSlotSize(k->limbs), k->zImag);
+}
+
+/*
+ * Move the records so every process holds an even share of them, keeping their global order.
+ * Process r ends up with records [r*total/p, (r+1)*total/p). Counts and displacements are in
+ * records of a contiguous type, so they only overflow an int past INT_MAX records per process.
+*/
+static unsigned char *rebalance(unsigned char *records, long int *count, size_t size, int my_rank, int p, MPI_Comm comm)
+{
+  long int total, first = 0, lo, hi;
+  int r;
+  MPI_Datatype record;
+
+  MPI_Allreduce(count, &total, 1, MPI_LONG, MPI_SUM, comm);
+  MPI_Exscan(count, &first, 1, MPI_LONG, MPI_SUM, comm);
+  if (my_rank == 0) first = 0;
+  if (*count > INT_MAX || (total + p - 1) / p > INT_MAX)
+  {
+    if (my_rank == 0) printf("Too many unresolved pixels per process to rebalance, use more processes\n");
+    MPI_Abort(comm, 1);
+  }
+
+  int *sendCounts = (int*)malloc(sizeof(int) * p);
+  int *sendDispl = (int*)malloc(sizeof(int) * p);
+  int *recvCounts = (int*)malloc(sizeof(int) * p);
+  int *recvDispl = (int*)malloc(sizeof(int) * p);
+  assert(sendCounts != NULL && sendDispl != NULL && recvCounts != NULL && recvDispl != NULL);
+
+  for (r = 0; r < p; r++)
+  {
+    lo = (first > r * total / p) ? first : r * total / p;
+    hi = (first + *count < (r + 1) * total / p) ? first + *count : (r + 1) * total / p;
+    sendCounts[r] = (hi > lo) ? hi - lo : 0;
+    sendDispl[r] = (hi > lo) ? lo - first : 0;
+  }
+
+  MPI_Alltoall(sendCounts, 1, MPI_INT, recvCounts, 1, MPI_INT, comm);
+
+  long int mine = (my_rank + 1) * total / p - my_rank * total / p;
+  for (r = 0; r < p; r++) recvDispl[r] = (r == 0) ? 0 : recvDispl[r - 1] + recvCounts[r - 1];
+
+  unsigned char *balanced = (unsigned char*)malloc(size * (mine > 0 ? mine : 1));
+  assert(balanced != NULL);
+
+  MPI_Type_contiguous(size, MPI_BYTE, &record);
+  MPI_Type_commit(&record);
+  MPI_Alltoallv(records, sendCounts, sendDispl, record, balanced, recvCounts, recvDispl, record, comm);
+  MPI_Type_free(&record);
+
+  free(sendCounts);
+  free(sendDispl);
+  free(recvCounts);
+  free(recvDispl);
+  free(records);
+
+  *count = mine;
+  return balanced;
+}
+
+long int EscalateJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci,
+	  int flag, int maxIterations, int *iterations, float *smooth, int budget, long int threshold, int my_rank, int p, MPI_Comm comm)
+{
+  long int totalCount = 0;
+  int done = FALSE;
+  int pass = 1;
+  int escaped, iteration, i;
+  float smoothValue;
+  long int j, pixel;
+
+  /* Set precision of numbers */
+  mpf_set_default_prec(mpf_get_prec(xmax));
+
+  Kernel k;
+  kernelInit(&k, xmin, xmax, xres, ymin, ymax, yres);
+  size_t size = recordSize(&k);
+
+  if (budget > maxIterations) budget = maxIterations;
+  if (my_rank == 0)
+    printf("Escalating from %d iterations up to %d, %ld bytes of orbit state per unresolved pixel\n", budget, maxIterations, (long int)size);
+
+  EscapedList esc;
+  esc.count = 0;
+  esc.size = INITIALSIZE;
+  esc.pixel = (long int*)malloc(sizeof(long int) * esc.size);
+  esc.iteration = (int*)malloc(sizeof(int) * esc.size);
+  esc.smooth = (float*)malloc(sizeof(float) * esc.size);
+  assert(esc.pixel != NULL && esc.iteration != NULL && esc.smooth != NULL);
+
+  long int unresolved = 0, recordsSize = INITIALSIZE;
+  unsigned char *records = (unsigned char*)malloc(size * recordsSize);
+  assert(records != NULL);
+
+  // First pass: an even block of rows per process, as in BlockPartitionJulia
+  long int startRow = my_rank * (yres / p) + ((my_rank < yres % p) ? my_rank : yres % p);
+  long int rows = yres / p + ((my_rank < yres % p) ? 1 : 0);
+  long int escapedBefore = 0;
+
+  for (pixel = startRow * xres; pixel < (startRow + rows) * xres; pixel++)
+  {
+    iteration = iteratePixel(&k, xmin, ymin, xres, cr, ci, flag, pixel, 0, budget, FALSE, &escaped, &smoothValue);
+    totalCount += iteration;
+
+    if (escaped) addEscaped(&esc, pixel, iteration, smoothValue);
+    else
+    {
+      if (unresolved == recordsSize)
+      {
+        recordsSize *= 2;
+        records = (unsigned char*)realloc(records, size * recordsSize);
+        assert(records != NULL);
+      }
+      writeRecord(&k, records + unresolved * size, pixel, iteration);
+      unresolved++;
+    }
+  }
+
+  while (done == FALSE)
+  {
+    long int local[2], global[2];
+    local[0] = esc.count - escapedBefore;
+    local[1] = unresolved;
+    MPI_Allreduce(local, global, 2, MPI_LONG, MPI_SUM, comm);
+    escapedBefore = esc.count;
+
+    if (my_rank == 0) printf("Pass %d: budget %d, %ld pixels escaped, %ld unresolved\n", pass, budget, global[0], global[1]);
+
+    if (global[1] == 0 || budget >= maxIterations || global[0] < threshold) done = TRUE;
+    else
+    {
+      // Spread the unresolved pixels evenly before the next pass
+      records = rebalance(records, &unresolved, size, my_rank, p, comm);
+      recordsSize = (unresolved > 0) ? unresolved : 1;
+
+      budget = (budget > maxIterations / 2) ? maxIterations : 2 * budget;
+      pass++;
+
+      long int kept = 0;
+      for (j = 0; j < unresolved; j++)
+      {
+        unsigned char *record = records + j * size;
+        long int *header = (long int*)record;
+        long int start = header[1];
+        assert(start <= budget);
+
+        unpackMpf(k.zReal, record + sizeof(long int) * 2);
+        unpackMpf(k.zImag, record + sizeof(long int) * 2 + mpfSlotSize(k.limbs));
+
+        iteration = iteratePixel(&k, xmin, ymin, xres, cr, ci, flag, header[0], (int)start, budget, TRUE, &escaped, &smoothValue);
+        totalCount += iteration - start;
+
+        if (escaped) addEscaped(&esc, header[0], iteration, smoothValue);
+        else
+        {
+          writeRecord(&k, records + kept * size, header[0], iteration);
+          kept++;
+        }
+      }
+      unresolved = kept;
+    }
+  }
+
+  // Collect the escaped pixels on process 0; anything left unresolved keeps maxIterations
+  int escCount = esc.count;
+  int *counts = NULL, *displ = NULL;
+  long int *allPixels = NULL;
+  int *allIterations = NULL;
+  float *allSmooth = NULL;
+
+  if (my_rank == 0)
+  {
+    counts = (int*)malloc(sizeof(int) * p);
+    displ = (int*)malloc(sizeof(int) * p);
+    assert(counts != NULL && displ != NULL);
+  }
+  MPI_Gather(&escCount, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+
+  if (my_rank == 0)
+  {
+    long int totalEscaped = 0;
+    for (i = 0; i < p; i++)
+    {
+      displ[i] = totalEscaped;
+      totalEscaped += counts[i];
+    }
+    allPixels = (long int*)malloc(sizeof(long int) * (totalEscaped + 1));
+    allIterations = (int*)malloc(sizeof(int) * (totalEscaped + 1));
+    allSmooth = (float*)malloc(sizeof(float) * (totalEscaped + 1));
+    assert(allPixels != NULL && allIterations != NULL && allSmooth != NULL);
+  }
+
+  MPI_Gatherv(esc.pixel, escCount, MPI_LONG, allPixels, counts, displ, MPI_LONG, 0, comm);
+  MPI_Gatherv(esc.iteration, escCount, MPI_INT, allIterations, counts, displ, MPI_INT, 0, comm);
+  if (smooth != NULL) MPI_Gatherv(esc.smooth, escCount, MPI_FLOAT, allSmooth, counts, displ, MPI_FLOAT, 0, comm);
+
+  if (my_rank == 0)
+  {
+    for (pixel = 0; pixel < xres * yres; pixel++) iterations[pixel] = maxIterations;
+    if (smooth != NULL) for (pixel = 0; pixel < xres * yres; pixel++) smooth[pixel] = maxIterations;
+
+    for (i = 0; i < p; i++)
+      for (j = displ[i]; j < displ[i] + counts[i]; j++)
+      {
+        iterations[allPixels[j]] = allIterations[j];
+        if (smooth != NULL) smooth[allPixels[j]] = allSmooth[j];
+      }
+
+    free(counts);
+    free(displ);
+    free(allPixels);
+    free(allIterations);
+    free(allSmooth);
+  }
+
+  // Free ALL OF THE MEMORY
+  free(esc.pixel);
+  free(esc.iteration);
+  free(esc.smooth);
+  free(records);
+  kernelClear(&k);
+
+  return totalCount;
+}
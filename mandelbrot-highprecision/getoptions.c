@@ -0,0 +1,118 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: getOptions
+ * Inputs: int argc - the number of arguements passed in from the command line
+ *         char **argv - the list of arguements passed in from the command line
+ *         JuliaOptions *options - a pointer to the options structure to fill in
+ * -------------------------------------------------------------------------------------------------
+ * This function parses the optional flags that may follow the parameter file on the command line:
+ *  -strategy <auto|serial|block|master|hierarchical> - force a work distribution strategy
+ *  -chunk <rows> - rows per task: per slave task in the master strategy, per node chunk in the
+ *                  hierarchical strategy
+ *  -raw <file> - also save the raw iteration field to file, see saveRaw
+ *  -smooth - compute smooth escape values and add them to the raw file
+ *  -escalate <iterations> - render in passes, starting at this budget and doubling up to maxiter
+ *  -threshold <pixels> - stop escalating once a pass resolves fewer pixels than this
+ *  -tune - choose the strategy and rows per task from a short calibration; -strategy and -chunk
+ *          still fix their part of the choice
+ *  -profile <file> - reuse autotune decisions saved in file, and save new ones there
+ *  -sweep <crmin> <crmax> <ncr> <cimin> <cimax> <nci> - render a grid of ncr x nci Julia sets
+ *  -thumb <pixels> - thumbnail width and height of a sweep (default 64)
+ *  -sweepdir <directory> - save one image per thumbnail instead of a single atlas
+ *  -noarena - let GMP use malloc and free instead of the arena of arena.c
+ * Options that are not given keep their default values. Unknown options are reported and ignored.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+#include <mpi.h>
+
+#include "julia.h"
+
+void getOptions(int argc, char **argv, JuliaOptions *options)
+{
+  int i;
+
+  // Defaults
+  options->strategy = STRATEGY_AUTO;
+  options->chunkRows = 0;
+  options->rawFile = NULL;
+  options->smooth = 0;
+  options->escalate = 0;
+  options->threshold = -1;
+  options->tune = 0;
+  options->profile = NULL;
+  options->sweepCount[0] = options->sweepCount[1] = 0;
+  options->thumb = 64;
+  options->sweepDir = NULL;
+  options->arena = 1;
+
+  // argv[1] is the parameter file
+  for (i = 2; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-strategy") == 0 && i + 1 < argc)
+    {
+      i++;
+      if (strcmp(argv[i], "auto") == 0) options->strategy = STRATEGY_AUTO;
+      else if (strcmp(argv[i], "serial") == 0) options->strategy = STRATEGY_SERIAL;
+      else if (strcmp(argv[i], "block") == 0) options->strategy = STRATEGY_BLOCK;
+      else if (strcmp(argv[i], "master") == 0) options->strategy = STRATEGY_MASTER;
+      else if (strcmp(argv[i], "hierarchical") == 0) options->strategy = STRATEGY_HIERARCHICAL;
+      else printf("Unknown strategy %s, using auto\n", argv[i]);
+    }
+    else if (strcmp(argv[i], "-chunk") == 0 && i + 1 < argc)
+    {
+      options->chunkRows = strtol(argv[++i], NULL, 0);
+    }
+    else if (strcmp(argv[i], "-raw") == 0 && i + 1 < argc)
+    {
+      options->rawFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "-smooth") == 0)
+    {
+      options->smooth = 1;
+    }
+    else if (strcmp(argv[i], "-escalate") == 0 && i + 1 < argc)
+    {
+      options->escalate = strtol(argv[++i], NULL, 0);
+    }
+    else if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc)
+    {
+      options->threshold = strtol(argv[++i], NULL, 0);
+    }
+    else if (strcmp(argv[i], "-tune") == 0)
+    {
+      options->tune = 1;
+    }
+    else if (strcmp(argv[i], "-profile") == 0 && i + 1 < argc)
+    {
+      options->profile = argv[++i];
+    }
+    else if (strcmp(argv[i], "-sweep") == 0 && i + 6 < argc)
+    {
+      options->sweepMin[0] = atof(argv[++i]);
+      options->sweepMax[0] = atof(argv[++i]);
+      options->sweepCount[0] = strtol(argv[++i], NULL, 0);
+      options->sweepMin[1] = atof(argv[++i]);
+      options->sweepMax[1] = atof(argv[++i]);
+      options->sweepCount[1] = strtol(argv[++i], NULL, 0);
+    }
+    else if (strcmp(argv[i], "-thumb") == 0 && i + 1 < argc)
+    {
+      options->thumb = strtol(argv[++i], NULL, 0);
+    }
+    else if (strcmp(argv[i], "-sweepdir") == 0 && i + 1 < argc)
+    {
+      options->sweepDir = argv[++i];
+    }
+    else if (strcmp(argv[i], "-noarena") == 0)
+    {
+      options->arena = 0;
+    }
+    else printf("Ignoring unknown option %s\n", argv[i]);
+  }
+
+  return;
+}
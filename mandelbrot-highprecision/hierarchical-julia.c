@@ -0,0 +1,256 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: HierarchicalJulia
+ * Inputs: mpf_t xmin, xmax - x coordinates
+ *         unsigned long int xres - the width of the complete image
+ *         mpf_t ymin, ymax - y coordinates
+ *         unsigned long int yres - the height of the complete image
+ *         mpf_t cr, ci - values of the imaginary number c + ci
+ *         int flag - indicates if the image is Mandelbrot or Julia set
+ *         int maxIterations - maximum number of hops to try to exit the unit circle
+ *         int *iterations - the complete image; only used on process 0
+ *         float *smooth - smooth escape values of the complete image; NULL if not wanted
+ *         long int chunkRows - rows a node takes from the coordinator at once; 0 picks a size
+ *         int my_rank - the id of the current process
+ *         int p - the total number of processes running
+ *         MPI_Comm comm - the MPI communicator of the program
+ * Outputs: long int totalCount - the number of iterations performed by the process
+ * -------------------------------------------------------------------------------------------------
+ * This function is a two-level version of TaskMasterJulia for runs that span several nodes.
+ *
+ * Processes are grouped by node with MPI_Comm_split_type. The lowest rank on each node is the
+ * node's sub-master. Process 0 is the global coordinator, but it does not run a dispatch loop:
+ * it only exposes a chunk counter and the image through MPI windows. A sub-master claims the next
+ * chunk of rows with a single MPI_Fetch_and_op and publishes it in a node shared memory window.
+ *
+ * Every process on the node (the sub-master included) then claims single rows of that chunk from
+ * a counter in the shared window and writes them straight into the shared chunk buffer. When the
+ * chunk is finished the sub-master forwards the whole chunk to process 0 with one MPI_Put. Across
+ * nodes this costs two messages per chunk instead of two messages per row.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <gmp.h>
+#include <mpi.h>
+
+#include "julia.h"
+
+// Process 0 holds the chunk counter and the image
+#define COORDINATOR 0
+
+// Node rank 0 is the node's sub-master
+#define SUBMASTER 0
+
+// Rows per worker in an automatically sized chunk
+#define ROWS_PER_WORKER 4
+
+// Minimum number of chunks per node, so nodes can still balance with each other
+#define CHUNKS_PER_NODE 4
+
+// Layout of the control block at the start of the node shared window
+#define CHUNKSTART 0
+#define ROWCOUNTER 1
+#define CONTROLSIZE 2
+
+// Booleans
+#define FALSE 0
+#define TRUE 1
+
+long int HierarchicalJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci,
+	  int flag, int maxIterations, int *iterations, float *smooth, long int chunkRows, int my_rank, int p, MPI_Comm comm)
+{
+  long int totalCount = 0;
+  long int one = 1;
+  int done = FALSE;
+  int i;
+
+  // Find the processes sharing this node
+  MPI_Comm nodeComm;
+  int nodeRank, nodeSize, nodes, isSubMaster;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, my_rank, MPI_INFO_NULL, &nodeComm);
+  MPI_Comm_rank(nodeComm, &nodeRank);
+  MPI_Comm_size(nodeComm, &nodeSize);
+
+  isSubMaster = (nodeRank == SUBMASTER);
+  MPI_Allreduce(&isSubMaster, &nodes, 1, MPI_INT, MPI_SUM, comm);
+
+  // Chunks are large enough to keep the node busy but leave several chunks per node
+  if (chunkRows <= 0)
+  {
+    long int balanced = yres / (nodes * CHUNKS_PER_NODE);
+    chunkRows = nodeSize * ROWS_PER_WORKER;
+    if (chunkRows > balanced) chunkRows = balanced;
+    if (chunkRows < 1) chunkRows = 1;
+  }
+
+  if (my_rank == COORDINATOR)
+    printf("Hierarchical task farm: %d nodes, %ld rows per chunk\n", nodes, chunkRows);
+
+  // Global chunk counter, stored on the coordinator
+  long int *nextChunk;
+  MPI_Win chunkWin;
+  MPI_Win_allocate((my_rank == COORDINATOR) ? sizeof(long int) : 0, sizeof(long int), MPI_INFO_NULL, comm, &nextChunk, &chunkWin);
+  if (my_rank == COORDINATOR) *nextChunk = 0;
+
+  // The image on the coordinator, sub-masters put finished chunks here
+  MPI_Win imageWin;
+  MPI_Win_create(iterations, (my_rank == COORDINATOR) ? (MPI_Aint)(sizeof(int) * xres * yres) : 0, sizeof(int), MPI_INFO_NULL, comm, &imageWin);
+
+  // Smooth values on the coordinator, forwarded the same way
+  MPI_Win smoothWin;
+  if (smooth != NULL)
+    MPI_Win_create(smooth, (my_rank == COORDINATOR) ? (MPI_Aint)(sizeof(float) * xres * yres) : 0, sizeof(float), MPI_INFO_NULL, comm, &smoothWin);
+
+  // Node shared window: control block followed by the chunk buffer and its smooth values
+  long int *control;
+  int *chunk;
+  float *smoothChunk = NULL;
+  MPI_Aint sharedSize;
+  int dispUnit;
+  MPI_Win nodeWin;
+  MPI_Win_allocate_shared((nodeRank == SUBMASTER) ? (MPI_Aint)(sizeof(long int) * CONTROLSIZE + (sizeof(int) + ((smooth != NULL) ? sizeof(float) : 0)) * xres * chunkRows) : 0,
+			  1, MPI_INFO_NULL, nodeComm, &control, &nodeWin);
+  MPI_Win_shared_query(nodeWin, SUBMASTER, &sharedSize, &dispUnit, &control);
+  chunk = (int*)(control + CONTROLSIZE);
+  if (smooth != NULL) smoothChunk = (float*)(chunk + xres * chunkRows);
+
+  // Counter must be initialized before anybody fetches from it
+  MPI_Barrier(comm);
+
+  MPI_Win_lock_all(0, chunkWin);
+  MPI_Win_lock_all(0, imageWin);
+  if (smooth != NULL) MPI_Win_lock_all(0, smoothWin);
+  MPI_Win_lock_all(0, nodeWin);
+
+  // Statistics
+  int rowsDone = 0;
+  int chunksDone = 0;
+
+  while (done == FALSE)
+  {
+    // Sub-master claims the next chunk for the node
+    if (nodeRank == SUBMASTER)
+    {
+      long int next;
+      MPI_Fetch_and_op(&one, &next, MPI_LONG, COORDINATOR, 0, MPI_SUM, chunkWin);
+      MPI_Win_flush(COORDINATOR, chunkWin);
+
+      // The previous chunk must have left the buffer before it is reused
+      MPI_Win_flush(COORDINATOR, imageWin);
+      if (smooth != NULL) MPI_Win_flush(COORDINATOR, smoothWin);
+
+      control[CHUNKSTART] = next * chunkRows;
+      control[ROWCOUNTER] = 0;
+    }
+
+    MPI_Win_sync(nodeWin);
+    MPI_Barrier(nodeComm);
+    MPI_Win_sync(nodeWin);
+
+    long int start = control[CHUNKSTART];
+    if (start >= yres) done = TRUE;
+    else
+    {
+      long int rows = chunkRows;
+      if (start + rows > yres) rows = yres - start;
+
+      // Claim rows of the chunk until it is exhausted
+      while (TRUE)
+      {
+        long int r;
+        MPI_Fetch_and_op(&one, &r, MPI_LONG, SUBMASTER, sizeof(long int) * ROWCOUNTER, MPI_SUM, nodeWin);
+        MPI_Win_flush(SUBMASTER, nodeWin);
+        if (r >= rows) break;
+
+        totalCount += julia(xmin, xmax, xres, xres, 0, ymin, ymax, 1, yres, start + r, cr, ci, flag, maxIterations, chunk + r * xres, (smooth != NULL) ? smoothChunk + r * xres : NULL);
+        rowsDone++;
+      }
+
+      MPI_Win_sync(nodeWin);
+      MPI_Barrier(nodeComm);
+      MPI_Win_sync(nodeWin);
+
+      // Forward the finished chunk to the coordinator as a single message
+      if (nodeRank == SUBMASTER)
+      {
+        if (my_rank == COORDINATOR)
+        {
+          memcpy(iterations + start * xres, chunk, sizeof(int) * xres * rows);
+          if (smooth != NULL) memcpy(smooth + start * xres, smoothChunk, sizeof(float) * xres * rows);
+        }
+        else
+        {
+          MPI_Put(chunk, xres * rows, MPI_INT, COORDINATOR, start * xres, xres * rows, MPI_INT, imageWin);
+          if (smooth != NULL) MPI_Put(smoothChunk, xres * rows, MPI_FLOAT, COORDINATOR, start * xres, xres * rows, MPI_FLOAT, smoothWin);
+        }
+        chunksDone++;
+      }
+    }
+  }
+
+  MPI_Win_unlock_all(nodeWin);
+  MPI_Win_unlock_all(imageWin);
+  if (smooth != NULL) MPI_Win_unlock_all(smoothWin);
+  MPI_Win_unlock_all(chunkWin);
+
+  // Output how much work each process did
+  int *allRows = NULL, *allChunks = NULL;
+  if (my_rank == COORDINATOR)
+  {
+    allRows = (int*)malloc(sizeof(int) * p);
+    assert(allRows != NULL);
+    allChunks = (int*)malloc(sizeof(int) * p);
+    assert(allChunks != NULL);
+  }
+  MPI_Gather(&rowsDone, 1, MPI_INT, allRows, 1, MPI_INT, COORDINATOR, comm);
+  MPI_Gather(&chunksDone, 1, MPI_INT, allChunks, 1, MPI_INT, COORDINATOR, comm);
+
+  if (my_rank == COORDINATOR)
+  {
+    for (i = 0; i < p; i++)
+    {
+      if (allChunks[i] > 0) printf("Rows completed on process %d: %d (sub-master, %d chunks forwarded)\n", i, allRows[i], allChunks[i]);
+      else printf("Rows completed on process %d: %d\n", i, allRows[i]);
+    }
+    free(allRows);
+    free(allChunks);
+  }
+
+  // Free ALL OF THE WINDOWS
+  MPI_Win_free(&nodeWin);
+  MPI_Win_free(&imageWin);
+  if (smooth != NULL) MPI_Win_free(&smoothWin);
+  MPI_Win_free(&chunkWin);
+  MPI_Comm_free(&nodeComm);
+
+  return totalCount;
+}
+
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: countNodes
+ * Inputs: MPI_Comm comm - the MPI communicator of the program
+ * Outputs: int nodes - the number of shared memory nodes the communicator spans
+ * -------------------------------------------------------------------------------------------------
+ * This function counts the nodes by splitting the communicator into shared memory groups and
+ * counting the group leaders. It must be called by every process in comm.
+*/
+
+int countNodes(MPI_Comm comm)
+{
+  MPI_Comm nodeComm;
+  int my_rank, nodeRank, isLeader, nodes;
+
+  MPI_Comm_rank(comm, &my_rank);
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, my_rank, MPI_INFO_NULL, &nodeComm);
+  MPI_Comm_rank(nodeComm, &nodeRank);
+
+  isLeader = (nodeRank == 0);
+  MPI_Allreduce(&isLeader, &nodes, 1, MPI_INT, MPI_SUM, comm);
+
+  MPI_Comm_free(&nodeComm);
+  return nodes;
+}
@@ -13,6 +13,7 @@
  *         int flag - indicates if the image is Mandelbrot or Julia set
  *         int maxIterations - maximum number of hops to try to exit the unit circle
  *         int *iterations - the memory block that julia is working on
+ *         float *smooth - memory block for smooth (fractional) escape counts; NULL to skip them
  * Outputs: int maxIterationCount - the maximum number of iterations required by any pixel in the
  *                                  memory block
  * -------------------------------------------------------------------------------------------------
@@ -22,17 +23,23 @@
  * Julia tried maxIterations times to leave the unit circle for each pixel and records that value in
  * iterations. The memory block iterations does not need to be explicitly returned because it is 
  * passed by reference.
+ * If smooth is given, the escape count is refined with the final magnitude of z as
+ * iteration + 1 - log2(log|z|), which colours without banding. Points that never escape
+ * store maxIterations.
+ * The GMP scratch variables are static and reused by the next call, so julia is not reentrant
+ * and must not be called from several threads at once.
 */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 #include <assert.h>
 #include <gmp.h>
 #include <mpi.h>
 
 #include "julia.h"
 
-long int julia(mpf_t xmin, mpf_t xmax, int xblock, unsigned long int xres, int startx, mpf_t ymin, mpf_t ymax, int yblock, unsigned long int yres, int starty, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations)
+long int julia(mpf_t xmin, mpf_t xmax, int xblock, unsigned long int xres, int startx, mpf_t ymin, mpf_t ymax, int yblock, unsigned long int yres, int starty, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations, float *smooth)
 {
   /* Maximum radius of the unit circle */
   const double maxRadius = 2.0;
@@ -48,33 +55,57 @@ long int julia(mpf_t xmin, mpf_t xmax, int xblock, unsigned long int xres, int s
   long int iterationCount = 0;
   int i, j;
   
-  /* Distance variables */
-  mpf_t xgap, ygap;
-
-  //mpf_inits(xgap, ygap, (mpf_t *) 0);
-  mpf_init(xgap);
-  mpf_init(ygap);
+  /* Scratch variables live across calls, so a call per row does not allocate. They are set up on
+     the first call and again only when the precision changes. The variables of the inner loop are
+     initialized first so their limbs sit next to each other in the arena (see arena.c) */
+  static long int scratchPrecision = 0;
 
   /* Complex calculation variables */
-  mpf_t zinitReal, zinitImag;
-  mpf_t z0Real, z0Imag;
-  mpf_t zReal, zImag;
-  mpf_t cReal, cImag;
-  mpf_t tempReal, tempImag;
-  mpf_t magnitude;
-   
-  //mpf_inits(zinitReal, zinitImag, z0Real, z0Imag, zReal, zImag, cReal, cImag, tempReal, tempImag, magnitude, (mpf_t *) 0);
-  mpf_init(zinitReal);
-  mpf_init(zinitImag);
-  mpf_init(z0Real);
-  mpf_init(z0Imag);
-  mpf_init(zReal);
-  mpf_init(zImag);
-  mpf_init(cReal);
-  mpf_init(cImag);
-  mpf_init(tempReal);
-  mpf_init(tempImag);
-  mpf_init(magnitude);
+  static mpf_t zReal, zImag;
+  static mpf_t tempReal, tempImag;
+  static mpf_t magnitude;
+  static mpf_t z0Real, z0Imag;
+  static mpf_t zinitReal, zinitImag;
+  static mpf_t cReal, cImag;
+
+  /* Distance variables */
+  static mpf_t xgap, ygap;
+
+  if (scratchPrecision == 0)
+  {
+    //mpf_inits(zReal, zImag, tempReal, tempImag, magnitude, z0Real, z0Imag, zinitReal, zinitImag, cReal, cImag, xgap, ygap, (mpf_t *) 0);
+    mpf_init(zReal);
+    mpf_init(zImag);
+    mpf_init(tempReal);
+    mpf_init(tempImag);
+    mpf_init(magnitude);
+    mpf_init(z0Real);
+    mpf_init(z0Imag);
+    mpf_init(zinitReal);
+    mpf_init(zinitImag);
+    mpf_init(cReal);
+    mpf_init(cImag);
+    mpf_init(xgap);
+    mpf_init(ygap);
+    scratchPrecision = precision;
+  }
+  else if (scratchPrecision != precision)
+  {
+    mpf_set_prec(zReal, precision);
+    mpf_set_prec(zImag, precision);
+    mpf_set_prec(tempReal, precision);
+    mpf_set_prec(tempImag, precision);
+    mpf_set_prec(magnitude, precision);
+    mpf_set_prec(z0Real, precision);
+    mpf_set_prec(z0Imag, precision);
+    mpf_set_prec(zinitReal, precision);
+    mpf_set_prec(zinitImag, precision);
+    mpf_set_prec(cReal, precision);
+    mpf_set_prec(cImag, precision);
+    mpf_set_prec(xgap, precision);
+    mpf_set_prec(ygap, precision);
+    scratchPrecision = precision;
+  }
   
   /* Converting coordinate to complex space */
   mpf_sub(xgap, xmax, xmin);    // xgap = (x[1] - x[0]) / xres;
@@ -152,23 +183,17 @@ long int julia(mpf_t xmin, mpf_t xmax, int xblock, unsigned long int xres, int s
 	  /* Calculate storage location and record iteration count for pixel */
 	  int *p = iterations + j*xres+i;
 	  *p = iteration;
+
+	  /* Fractional escape count from |z|^2 at escape: log|z| = log(|z|^2) / 2 */
+	  if (smooth != NULL)
+	  {
+	    if (compare < 0) smooth[j*xres+i] = maxIterations;
+	    else smooth[j*xres+i] = iteration + 1 - log2(0.5 * log(mpf_get_d(magnitude)));
+	  }
 	}
     }
 
-  //mpf_clears(zinitReal, zinitImag, z0Real, z0Imag, zReal, zImag, cReal, cImag, tempReal, tempImag, magnitude, (mpf_t *) 0);
-  mpf_clear(zinitReal);
-  mpf_clear(zinitImag);
-  mpf_clear(z0Real);
-  mpf_clear(z0Imag);
-  mpf_clear(zReal);
-  mpf_clear(zImag);
-  mpf_clear(cReal);
-  mpf_clear(cImag);
-  mpf_clear(tempReal);
-  mpf_clear(tempImag);
-  mpf_clear(magnitude);
-  mpf_clear(xgap);
-  mpf_clear(ygap);
+  /* Scratch variables are kept for the next call; the arena is released by main */
 
   return iterationCount;
 }
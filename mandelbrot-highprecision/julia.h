@@ -4,16 +4,82 @@
  * run the Julia program.
 */
 
+/* Work distribution strategies selectable with -strategy; AUTO lets parallelJulia decide */
+#define STRATEGY_AUTO 0
+#define STRATEGY_SERIAL 1
+#define STRATEGY_BLOCK 2
+#define STRATEGY_MASTER 3
+#define STRATEGY_HIERARCHICAL 4
+
+/* Optional command line settings that follow the parameter file */
+typedef struct
+{
+  int strategy;         // one of the STRATEGY_* values
+  long int chunkRows;   // rows per node-level chunk for HierarchicalJulia; 0 picks automatically
+  char *rawFile;        // raw iteration field output (-raw); NULL if not wanted
+  int smooth;           // also compute and store smooth escape values (-smooth)
+  int escalate;         // first pass iteration budget for EscalateJulia (-escalate); 0 renders in one pass
+  long int threshold;   // stop escalating once a pass resolves fewer pixels (-threshold); -1 picks automatically
+  int tune;             // choose strategy and chunk size with autotuneJulia (-tune)
+  char *profile;        // file of saved autotune decisions for this machine (-profile); NULL if none
+  double sweepMin[2];   // first real and imaginary c of a parameter sweep (-sweep)
+  double sweepMax[2];   // last real and imaginary c of a parameter sweep
+  int sweepCount[2];    // number of real and imaginary c values; 0 for a normal render
+  long int thumb;       // thumbnail width and height of a sweep (-thumb)
+  char *sweepDir;       // save one image per thumbnail here instead of an atlas (-sweepdir)
+  int arena;            // serve GMP allocations from the arena of arena.c; 0 with -noarena
+} JuliaOptions;
+
+/* Raw iteration field file: a RAWHEADERSIZE byte header, width*height ints, then optionally
+   width*height floats of smooth escape values. All values are in the writer's byte order. */
+#define RAWMAGIC "JULIARAW"
+#define RAWVERSION 1
+#define RAWHEADERSIZE 64
+#define RAWSMOOTH 1
+
+typedef struct
+{
+  char magic[8];                // RAWMAGIC, not null terminated
+  unsigned int version;         // RAWVERSION
+  unsigned int flags;           // RAWSMOOTH if the smooth array follows the iterations
+  unsigned long long width;
+  unsigned long long height;
+  int maxIterations;
+  int flag;                     // 0 - Julia set, 1 - Mandelbrot set
+  char reserved[RAWHEADERSIZE - 40];
+} RawHeader;
+
 long int TaskMasterJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, 
-	  int flag, int maxIterations, int *iterations, int my_rank, int p, MPI_Comm comm);
+	  int flag, int maxIterations, int *iterations, float *smooth, long int rowsPerTask, int my_rank, int p, MPI_Comm comm);
+
+long int BlockPartitionJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations, float *smooth, int my_rank, int p, MPI_Comm comm);
+
+long int HierarchicalJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, 
+	  int flag, int maxIterations, int *iterations, float *smooth, long int chunkRows, int my_rank, int p, MPI_Comm comm);
+
+long int EscalateJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, 
+	  int flag, int maxIterations, int *iterations, float *smooth, int budget, long int threshold, int my_rank, int p, MPI_Comm comm);
 
-long int BlockPartitionJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations, int my_rank, int p, MPI_Comm comm);
+void autotuneJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, 
+	  int flag, int maxIterations, JuliaOptions *options, int *strategy, long int *chunkRows, int my_rank, int p, MPI_Comm comm);
+
+long int SweepJulia(mpf_t xmin, mpf_t xmax, mpf_t ymin, mpf_t ymax, int maxIterations, char *image, JuliaOptions *options, int my_rank, int p, MPI_Comm comm);
 
 long int parallelJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, 
-	  int flag, int maxIterations, int *iterations, int my_rank, int p, MPI_Comm comm);
+	  int flag, int maxIterations, int *iterations, float *smooth, JuliaOptions *options, int my_rank, int p, MPI_Comm comm);
 
-long int julia(mpf_t xmin, mpf_t xmax, int xblock, unsigned long int xres, int startx, mpf_t ymin, mpf_t ymax, int yblock, unsigned long int yres, int starty, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations);
+long int julia(mpf_t xmin, mpf_t xmax, int xblock, unsigned long int xres, int startx, mpf_t ymin, mpf_t ymax, int yblock, unsigned long int yres, int starty, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations, float *smooth);
 
 void getParams(char **argv, int *flag, mpf_t *cr, mpf_t *ci, mpf_t *x, mpf_t *y, mpf_t *xr, mpf_t *yr, unsigned long int *height, unsigned long int *width, int *maxiter, char **image);
 
+void getOptions(int argc, char **argv, JuliaOptions *options);
+
+int countNodes(MPI_Comm comm);
+
+void arenaInstall(size_t bytes);
+
+void arenaRelease();
+
 void saveBMP(char* filename, int* result, int width, int height);
+
+void saveRaw(char *filename, int *iterations, float *smooth, unsigned long int width, unsigned long int height, int maxIterations, int flag, int my_rank, MPI_Comm comm);
@@ -12,6 +12,11 @@
  * calculations. When each process finishes, the timer is stopped and the statistics are collected on
  * process 0 for output to a stats file. Process 0 is also responsible for converting the iterations
  * calculated by Julia and converting them into .bmp files.
+ *
+ * With -sweep, a grid of c values is rendered as thumbnails by SweepJulia instead of one image.
+ * With -raw, the iteration counts (and with -smooth the smooth escape values) are also saved
+ * unreduced so the image can be recoloured by recolor without computing it again.
+ * GMP allocates from the arena of arena.c unless -noarena is given.
 */
 
 #include <stdlib.h>
@@ -28,8 +33,13 @@ int main(int argc, char *argv[])
   int maxiter, flag;
   unsigned long int width, height;
   char *image;
+  JuliaOptions options;
   //long int precision, temp;
 
+  // Options first: the GMP arena has to be in place before the first mpf_init
+  getOptions(argc, argv, &options);
+  if (options.arena) arenaInstall(0);
+
   mpf_t cr, ci, x, y, xr, yr, xmin, xmax, ymin, ymax;
   mpf_set_default_prec(300);
   //mpf_inits(cr, ci, x, y, xr, yr, xmin, xmax, ymin, ymax, (mpf_t *) 0);
@@ -63,6 +73,14 @@ int main(int argc, char *argv[])
   int *iterations = (int*)malloc( sizeof(int) * width * height );
   assert(iterations != NULL);
 
+  // Allocate space for smooth escape values if they are wanted
+  float *smooth = NULL;
+  if (options.smooth)
+  {
+    smooth = (float*)malloc( sizeof(float) * width * height );
+    assert(smooth != NULL);
+  }
+
   MPI_Init(NULL, NULL);
   MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
@@ -97,9 +115,11 @@ int main(int argc, char *argv[])
 
   t1 = MPI_Wtime();
 
-  /* Compute Julia set */
+  /* Compute Julia set, or one thumbnail per c value for a sweep */
   long int count;
-  count = parallelJulia(xmin, xmax, width, ymin, ymax, height, cr, ci, flag, maxiter, iterations, my_rank, comm_sz, MPI_COMM_WORLD);
+  int sweep = (options.sweepCount[0] > 0 && options.sweepCount[1] > 0);
+  if (sweep) count = SweepJulia(xmin, xmax, ymin, ymax, maxiter, image, &options, my_rank, comm_sz, MPI_COMM_WORLD);
+  else count = parallelJulia(xmin, xmax, width, ymin, ymax, height, cr, ci, flag, maxiter, iterations, smooth, &options, my_rank, comm_sz, MPI_COMM_WORLD);
 
   t2 = MPI_Wtime();
 
@@ -110,7 +130,7 @@ int main(int argc, char *argv[])
   MPI_Reduce(&count, &totalIterations, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
   MPI_Reduce(&delta, &maxTime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 
-  if (my_rank == 0)
+  if (my_rank == 0 && !sweep)
   {
     /* save our picture for the viewer */
     printf("\nMaster process %d creating image...\n", my_rank);
@@ -118,6 +138,13 @@ int main(int argc, char *argv[])
     printf("%d  %lf  %ld\n", comm_sz, maxTime, totalIterations);
   }
 
+  /* save the raw iteration field for recolouring */
+  if (options.rawFile != NULL && !sweep)
+  {
+    if (my_rank == 0) printf("Saving raw iteration field to %s\n", options.rawFile);
+    saveRaw(options.rawFile, iterations, smooth, width, height, maxiter, flag, my_rank, MPI_COMM_WORLD);
+  }
+
   MPI_Finalize();
 
   // Free reserved memory
@@ -133,6 +160,10 @@ int main(int argc, char *argv[])
   mpf_clear(ymin);
   mpf_clear(ymax);
   free(iterations);
+  free(smooth);
+
+  // Free ALL OF THE GMP MEMORY
+  if (options.arena) arenaRelease();
 
   return 0;
 }
@@ -11,6 +11,8 @@
  *         int flag - indicates if the image is Mandelbrot or Julia set
  *         int maxIterations - maximum number of hops to try to exit the unit circle
  *         int *iterations - the memory block that julia is working on
+ *         float *smooth - the memory block for smooth escape values; NULL if not wanted
+ *         long int rowsPerTask - the number of rows handed out in one task
  *         int my_rank - the id of the current process
  *         int p - the total number of processes running
  *         MPI_Comm comm - the MPI communicator of the program
@@ -23,9 +25,11 @@
  * in the image, the Master sends each slave process a DONE signal and exits.
  * 
  * All other processes are slaves. They are assigned work on a row-by-row basis. Slaves receive rows
- * as indexes and compute the Julia set for that row. It then passes back the row and waits for the 
- * next message from the Master. If there are more rows, the Master sends a new row index. If there
- * are no rows left, the Master sends a DONE message and the slave process exits.
+ * as indexes and compute the Julia set for that row and the following rowsPerTask - 1 rows. It then
+ * passes back the rows and waits for the next message from the Master. If there are more rows, the
+ * Master sends a new row index. If there are no rows left, the Master sends a DONE message and the
+ * slave process exits.
+ * When smooth values are wanted, each row is followed by a second message holding its smooth values.
 */
 
 #include <stdlib.h>
@@ -40,6 +44,7 @@
 #define TYPEROW 0
 #define TYPERETURN 1
 #define TYPEDONE 2
+#define TYPESMOOTH 3
 
 // Define process 0 as master
 #define MASTER 0
@@ -52,7 +57,7 @@
 #define TRUE 1
 
 long int TaskMasterJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, 
-	  int flag, int maxIterations, int *iterations, int my_rank, int p, MPI_Comm comm)
+	  int flag, int maxIterations, int *iterations, float *smooth, long int rowsPerTask, int my_rank, int p, MPI_Comm comm)
 {
   int totalCount = 0;
   int done = FALSE;
@@ -65,9 +70,17 @@ long int TaskMasterJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t y
 
   // Block for passing rows between processes
   int *block;
-  block = ( int* )malloc( sizeof(int) * xres );
+  block = ( int* )malloc( sizeof(int) * xres * rowsPerTask );
   assert(block != NULL);
 
+  // Block for passing smooth values of a row
+  float *smoothBlock = NULL;
+  if (smooth != NULL)
+  {
+    smoothBlock = ( float* )malloc( sizeof(float) * xres * rowsPerTask );
+    assert(smoothBlock != NULL);
+  }
+
   // Master process is only responsible for row allocation - does no work on Julia
   if (my_rank == MASTER)
   {   
@@ -97,32 +110,37 @@ long int TaskMasterJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t y
     // Initialize row counters for each process
     for (i = 0; i < p; i++) processRows[i] = 0;
 
-    // Initially send one row to each slave process
-    for (i = 1; i < p; i++)
+    // Initially send one task to each slave process
+    for (i = 1; i < p && sent < yres; i++)
     {
        *row = sent;
        MPI_Send(row, SIZE, MPI_INT, i, TYPEROW, comm);
        tracker[i] = *row;
-       sent++;
+       sent += rowsPerTask;
     }
     
     // Have not heard about every row completion
     while (done == FALSE)
     {
        // Receive message from any process
-       MPI_Recv(block, xres, MPI_INT, MPI_ANY_SOURCE, TYPERETURN, comm, &status);       
+       MPI_Recv(block, xres * rowsPerTask, MPI_INT, MPI_ANY_SOURCE, TYPERETURN, comm, &status);       
+       if (smooth != NULL) MPI_Recv(smoothBlock, xres * rowsPerTask, MPI_FLOAT, status.MPI_SOURCE, TYPESMOOTH, comm, MPI_STATUS_IGNORE);
 
        // Make sure row is in bounds
        if (tracker[status.MPI_SOURCE] < yres)
        {
+         // The last task may be short
+         int rows = (tracker[status.MPI_SOURCE] + rowsPerTask > yres) ? yres - tracker[status.MPI_SOURCE] : rowsPerTask;
+
          // Update processed and received counters
-         processRows[status.MPI_SOURCE]++;
-         recv++;
+         processRows[status.MPI_SOURCE] += rows;
+         recv += rows;
          printf("\rCompleted: %lf%%", ((double)recv/yres)*100);
 
          // Put row data into image memory block
          location = tracker[status.MPI_SOURCE]*xres;
-         for(i = 0; i < xres; i++) iterations[location + i] = block[i];
+         for(i = 0; i < xres * rows; i++) iterations[location + i] = block[i];
+         if (smooth != NULL) for(i = 0; i < xres * rows; i++) smooth[location + i] = smoothBlock[i];
 
          // Received all rows from slave processes; send out DONE signal and exit
          if(recv == yres) 
@@ -133,13 +151,13 @@ long int TaskMasterJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t y
        
          // Have not sent all rows yet
          //if(done == FALSE)
-         else
+         else if (sent < yres)
          {
            // Get next row, send to slave process, and update tracker and global sent counter
            *row = sent;
            MPI_Send(row, SIZE, MPI_INT, status.MPI_SOURCE, TYPEROW, comm);
            tracker[status.MPI_SOURCE] = *row;
-	   sent++;
+	   sent += rowsPerTask;
          }
        }
     }
@@ -169,11 +187,15 @@ long int TaskMasterJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t y
     
       if(status.MPI_TAG != TYPEDONE)
       {
+        // The last task may be short
+        int rows = (*row + rowsPerTask > yres) ? yres - *row : rowsPerTask;
+
         // Run Julia function, return block of iteration values
-        count = julia(xmin, xmax, xres, xres, 0, ymin, ymax, SIZE, yres, *row, cr, ci, flag, maxIterations, block);
+        count = julia(xmin, xmax, xres, xres, 0, ymin, ymax, rows, yres, *row, cr, ci, flag, maxIterations, block, smoothBlock);
         totalCount += count;
 
-        MPI_Send(block, xres, MPI_INT, MASTER, TYPERETURN, comm);
+        MPI_Send(block, xres * rows, MPI_INT, MASTER, TYPERETURN, comm);
+        if (smooth != NULL) MPI_Send(smoothBlock, xres * rows, MPI_FLOAT, MASTER, TYPESMOOTH, comm);
       }
       // Received DONE signal from MASTER - no more tasks
       else done = TRUE;
@@ -183,6 +205,7 @@ long int TaskMasterJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t y
   // Free ALL OF THE MEMORY
   free(row);
   free(block);
+  free(smoothBlock);
 
   return totalCount;
 }
@@ -11,6 +11,8 @@
  *         int flag - indicates if the image is Mandelbrot or Julia set
  *         int maxIterations - maximum number of hops to try to exit the unit circle
  *         int *iterations - the memory block that julia is working on
+ *         float *smooth - the memory block for smooth escape values; NULL if not wanted
+ *         JuliaOptions *options - command line options; options->strategy may force an algorithm
  *         int my_rank - the id of the current process
  *         int p - the total number of processes running
  *         MPI_Comm comm - the MPI communicator of the program
@@ -22,6 +24,11 @@
  *  - # Processes = 1: Serial program; call julia function directly
  *  - # Processes = 2: Not enough processes to require a task master; send to BlockPartitionJulia
  *  - # Processes > 2: Enough processes to require a task master; send to TaskMasterJulia
+ *  - # Processes > 2 on several nodes: a single master would receive every row over the network;
+ *                                       send to HierarchicalJulia
+ * A strategy given with -strategy overrides this choice. With -tune, autotuneJulia makes the choice,
+ * and the rows per task, from a calibration run instead.
+ * With -escalate the image is instead rendered in passes of growing budgets by EscalateJulia.
 */
 
 #include <stdlib.h>
@@ -33,26 +40,60 @@
 #include "julia.h"
 
 long int parallelJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, 
-	  int flag, int maxIterations, int *iterations, int my_rank, int p, MPI_Comm comm)
+	  int flag, int maxIterations, int *iterations, float *smooth, JuliaOptions *options, int my_rank, int p, MPI_Comm comm)
 {
   long int count;
+  int strategy = options->strategy;
+  long int chunkRows = options->chunkRows;
 
-  if (p == 1)
+  if (options->escalate > 0)
+  {
+    // By default stop once a pass resolves less than 0.01% of the image
+    long int threshold = options->threshold;
+    if (threshold < 0) threshold = xres * yres / 10000;
+
+    if(my_rank == 0) printf("Escalating iteration budget - unresolved pixels are rebalanced between passes\n\n");
+    return EscalateJulia(xmin, xmax, xres, ymin, ymax, yres, cr, ci, flag, maxIterations, iterations, smooth, options->escalate, threshold, my_rank, p, comm);
+  }
+
+  if (options->tune)
+    autotuneJulia(xmin, xmax, xres, ymin, ymax, yres, cr, ci, flag, maxIterations, options, &strategy, &chunkRows, my_rank, p, comm);
+
+  if (strategy == STRATEGY_AUTO)
+  {
+    if (p == 1) strategy = STRATEGY_SERIAL;
+    else if (p == 2) strategy = STRATEGY_BLOCK;
+    else if (countNodes(comm) > 1) strategy = STRATEGY_HIERARCHICAL;
+    else strategy = STRATEGY_MASTER;
+  }
+
+  // A task farm needs at least one slave
+  if ((strategy == STRATEGY_MASTER || strategy == STRATEGY_HIERARCHICAL) && p == 1) strategy = STRATEGY_SERIAL;
+
+  if (strategy == STRATEGY_SERIAL)
   {
     if(my_rank == 0) printf("Single process - serial version\n\n");
     printf("Process %d...aren't you happy I'm here?\n", my_rank);
 
-    count = julia(xmin, xmax, xres, xres, 0, ymin, ymax, yres, yres, 0, cr, ci, flag, maxIterations, iterations);
+    // Only process 0 holds the image
+    if (my_rank == 0) count = julia(xmin, xmax, xres, xres, 0, ymin, ymax, yres, yres, 0, cr, ci, flag, maxIterations, iterations, smooth);
+    else count = 0;
   }
-  else if (p == 2)
+  else if (strategy == STRATEGY_BLOCK)
   {
     if(my_rank == 0) printf("Not enough processes - divide image at middle height and use scatterv/gatherv\n\n");
-    count = BlockPartitionJulia(xmin, xmax, xres, ymin, ymax, yres, cr, ci, flag, maxIterations, iterations, my_rank, p, comm);
+    count = BlockPartitionJulia(xmin, xmax, xres, ymin, ymax, yres, cr, ci, flag, maxIterations, iterations, smooth, my_rank, p, comm);
+  }
+  else if (strategy == STRATEGY_HIERARCHICAL)
+  {
+    if(my_rank == 0) printf("Multiple nodes - node sub-masters take chunks from process 0\n\n");
+    count = HierarchicalJulia(xmin, xmax, xres, ymin, ymax, yres, cr, ci, flag, maxIterations, iterations, smooth, chunkRows, my_rank, p, comm);
   }
   else
   {
     if(my_rank == 0) printf("Sufficient processes - run process 0 as task master\n\n");
-    count = TaskMasterJulia(xmin, xmax, xres, ymin, ymax, yres, cr, ci, flag, maxIterations, iterations, my_rank, p, comm);
+    if (chunkRows < 1) chunkRows = 1;
+    count = TaskMasterJulia(xmin, xmax, xres, ymin, ymax, yres, cr, ci, flag, maxIterations, iterations, smooth, chunkRows, my_rank, p, comm);
   }
 
   return count;
@@ -9,6 +9,7 @@
  *         int flag - indicates if the image is Mandelbrot or Julia set
  *         int maxIterations - maximum number of hops to try to exit the unit circle
  *         int *iterations - the memory block that julia is working on
+ *         float *smooth - the memory block for smooth escape values; NULL if not wanted
  *         int my_rank - the id of the current process
  *         int p - the total number of processes running
  *         MPI_Comm comm - the MPI communicator of the program
@@ -27,7 +28,7 @@
 
 #include "julia.h"
 
-long int BlockPartitionJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations, int my_rank, int p, MPI_Comm comm)
+long int BlockPartitionJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf_t ymin, mpf_t ymax, unsigned long int yres, mpf_t cr, mpf_t ci, int flag, int maxIterations, int *iterations, float *smooth, int my_rank, int p, MPI_Comm comm)
 {
   int i;
 
@@ -68,7 +69,7 @@ long int BlockPartitionJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf
 
     // Determine row offset for julia.c
     if (i == 0) offset[i] = 0;
-    else offset[i] = offset[i - 1] + block_size[i];
+    else offset[i] = offset[i - 1] + block_size[i - 1];
   }
 
   if(my_rank == 0)
@@ -83,15 +84,24 @@ long int BlockPartitionJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf
   block = ( int* )malloc( sizeof(int) * sendElements[my_rank] );
   assert(block != NULL);
 
+  float *smoothBlock = NULL;
+  if (smooth != NULL)
+  {
+    smoothBlock = ( float* )malloc( sizeof(float) * sendElements[my_rank] );
+    assert(smoothBlock != NULL);
+  }
+
   // Send data to processes
   MPI_Scatterv(iterations, sendElements, displacement, MPI_INT, block, sendElements[my_rank], MPI_INT, 0, comm);  
 
   // Run julia
   int xblock = xres;
-  long int count = julia(xmin, xmax, xblock, xres, 0, ymin, ymax, block_size[my_rank], yres, offset[my_rank], cr, ci, flag, maxIterations, block);
+  long int count = julia(xmin, xmax, xblock, xres, 0, ymin, ymax, block_size[my_rank], yres, offset[my_rank], cr, ci, flag, maxIterations, block, smoothBlock);
 
   // Gather blocks back into interations
   MPI_Gatherv(block, sendElements[my_rank], MPI_INT, iterations, sendElements, displacement, MPI_INT, 0, comm);
+  if (smooth != NULL)
+    MPI_Gatherv(smoothBlock, sendElements[my_rank], MPI_FLOAT, smooth, sendElements, displacement, MPI_FLOAT, 0, comm);
 
   // Free ALL OF THE MEMORY!!!
   free(block_size);
@@ -99,6 +109,7 @@ long int BlockPartitionJulia(mpf_t xmin, mpf_t xmax, unsigned long int xres, mpf
   free(displacement);
   free(offset);
   free(block);
+  free(smoothBlock);
 
   return count;
 }
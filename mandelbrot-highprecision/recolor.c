@@ -0,0 +1,195 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: main (recolor)
+ * Inputs: int argc - the number of arguements passed in from the command line
+ *         char *argv - the list of arguements passed in from the command line
+ *           argv[1] - raw iteration field written by julia -raw
+ *           argv[2] - the .bmp file to create
+ *           -palette <table|smooth> - colouring to use (default table)
+ *           -cycle <n> - length of the colour cycle in iterations for the smooth palette (default 64)
+ * -------------------------------------------------------------------------------------------------
+ * This program colours a raw iteration field (see saveRaw) without computing the image again.
+ *
+ * The raw file is mapped with mmap and the output .bmp file is created at its final size and
+ * mapped as well, so rows are coloured straight from one mapping into the other. Rows are split
+ * between OpenMP threads and only the pages being worked on are ever loaded.
+ *
+ * The table palette reproduces saveBMP exactly. The smooth palette uses the smooth escape values
+ * when the file has them (julia -smooth) and the plain iteration counts otherwise; points that
+ * never escaped are black.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <gmp.h>
+#include <mpi.h>
+#include <omp.h>
+
+#include "julia.h"
+
+#define PALETTE_TABLE 0
+#define PALETTE_SMOOTH 1
+
+#define BMPHEADERSIZE 54
+
+void getPalette(unsigned char palette[256][3]);
+
+int main(int argc, char *argv[])
+{
+  int i, mode = PALETTE_TABLE;
+  double cycle = 64;
+  double t1, t2;
+
+  if (argc < 3)
+  {
+    printf("Usage: %s <raw file> <image.bmp> [-palette table|smooth] [-cycle n]\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 3; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-palette") == 0 && i + 1 < argc)
+    {
+      i++;
+      if (strcmp(argv[i], "smooth") == 0) mode = PALETTE_SMOOTH;
+      else if (strcmp(argv[i], "table") == 0) mode = PALETTE_TABLE;
+      else printf("Unknown palette %s, using table\n", argv[i]);
+    }
+    else if (strcmp(argv[i], "-cycle") == 0 && i + 1 < argc) cycle = atof(argv[++i]);
+    else printf("Ignoring unknown option %s\n", argv[i]);
+  }
+
+  t1 = omp_get_wtime();
+
+  // Map the raw iteration field
+  int in = open(argv[1], O_RDONLY);
+  if (in < 0)
+  {
+    perror("Error opening raw file");
+    return 1;
+  }
+
+  struct stat st;
+  fstat(in, &st);
+  if (st.st_size < RAWHEADERSIZE)
+  {
+    printf("%s is too small to be a raw iteration field\n", argv[1]);
+    return 1;
+  }
+
+  unsigned char *raw = (unsigned char*)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, in, 0);
+  if (raw == MAP_FAILED)
+  {
+    perror("Error mapping raw file");
+    return 1;
+  }
+
+  RawHeader *header = (RawHeader*)raw;
+  if (memcmp(header->magic, RAWMAGIC, sizeof(header->magic)) != 0 || header->version != RAWVERSION)
+  {
+    printf("%s is not a raw iteration field\n", argv[1]);
+    return 1;
+  }
+
+  long w = header->width;
+  long h = header->height;
+  int maxIterations = header->maxIterations;
+  off_t expected = RAWHEADERSIZE + (off_t)sizeof(int) * w * h;
+  if (header->flags & RAWSMOOTH) expected += (off_t)sizeof(float) * w * h;
+  if (st.st_size < expected)
+  {
+    printf("%s is truncated\n", argv[1]);
+    return 1;
+  }
+
+  int *result = (int*)(raw + RAWHEADERSIZE);
+  float *smooth = (header->flags & RAWSMOOTH) ? (float*)(result + w * h) : NULL;
+
+  // Create the image at its final size and map it
+  long rowSize = (3 * w + 3) & ~3L;
+  long filesize = BMPHEADERSIZE + rowSize * h;
+
+  int out = open(argv[2], O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (out < 0 || ftruncate(out, filesize) != 0)
+  {
+    perror("Error creating image");
+    return 1;
+  }
+
+  unsigned char *img = (unsigned char*)mmap(NULL, filesize, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+  if (img == MAP_FAILED)
+  {
+    perror("Error mapping image");
+    return 1;
+  }
+
+  // Same headers as saveBMP
+  unsigned char bmpfileheader[14] = {'B','M', 0,0,0,0, 0,0, 0,0, 54,0,0,0};
+  unsigned char bmpinfoheader[40] = {40,0,0,0, 0,0,0,0, 0,0,0,0, 1,0, 24,0};
+
+  for (i = 0; i < 4; i++)
+  {
+    bmpfileheader[2 + i] = (unsigned char)(filesize >> (8 * i));
+    bmpinfoheader[4 + i] = (unsigned char)(w >> (8 * i));
+    bmpinfoheader[8 + i] = (unsigned char)(h >> (8 * i));
+  }
+  memcpy(img, bmpfileheader, 14);
+  memcpy(img + 14, bmpinfoheader, 40);
+
+  unsigned char palette[256][3];
+  getPalette(palette);
+
+  long j;
+#pragma omp parallel for schedule(dynamic, 16)
+  for (j = 0; j < h; j++)
+  {
+    unsigned char *row = img + BMPHEADERSIZE + j * rowSize;
+    long k;
+
+    for (k = 0; k < w; k++)
+    {
+      unsigned char *pixel = row + 3 * k;
+
+      if (mode == PALETTE_TABLE)
+      {
+        int index = result[j * w + k] % 255;
+        pixel[2] = palette[index][0];
+        pixel[1] = palette[index][1];
+        pixel[0] = palette[index][2];
+      }
+      else
+      {
+        double t = (smooth != NULL) ? smooth[j * w + k] : result[j * w + k];
+
+        if (result[j * w + k] >= maxIterations) pixel[0] = pixel[1] = pixel[2] = 0;
+        else
+        {
+          // Cosine gradient, phase shifted per channel
+          double phase = 2 * M_PI * t / cycle;
+          pixel[2] = (unsigned char)(127.5 * (1 + cos(phase)));
+          pixel[1] = (unsigned char)(127.5 * (1 + cos(phase + 2.0)));
+          pixel[0] = (unsigned char)(127.5 * (1 + cos(phase + 4.0)));
+        }
+      }
+    }
+
+    // Row padding
+    for (k = 3 * w; k < rowSize; k++) row[k] = 0;
+  }
+
+  munmap(img, filesize);
+  close(out);
+  munmap(raw, st.st_size);
+  close(in);
+
+  t2 = omp_get_wtime();
+  printf("%ld x %ld image coloured with %d threads in %lf seconds\n", w, h, omp_get_max_threads(), t2 - t1);
+
+  return 0;
+}
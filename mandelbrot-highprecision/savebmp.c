@@ -8,6 +8,7 @@
  * -------------------------------------------------------------------------------------------------
  * This function takes in a set of INT values, maps them to one of 256 colours, then outputs the 
  * pixel to a .bmp file called filename.
+ * getPalette copies the same 256 colours out for programs that colour pixels themselves.
 */
 
 #include<stdio.h>
@@ -49,11 +50,24 @@ void initColours()
     }
 }
 
+void getPalette(unsigned char palette[256][3])
+{
+  int i;
+
+  initColours();
+  for (i = 0; i < 256; i++)
+    {
+      palette[i][0] = table[i].r;
+      palette[i][1] = table[i].g;
+      palette[i][2] = table[i].b;
+    }
+}
+
 void saveBMP(char* filename, int* result, int w, int h){
         initColours();
 	FILE *f;
 	unsigned char *img = NULL;
-	int filesize = 54 + 3*w*h;  //w is your image width, h is image height, both int
+	int filesize = 54 + ((3*w + 3) & ~3)*h;  //w is your image width, h is image height, both int; rows are padded to 4 bytes
 
 	unsigned char bmpfileheader[14] = {'B','M', 0,0,0,0, 0,0, 0,0, 54,0,0,0};
 	unsigned char bmpinfoheader[40] = {40,0,0,0, 0,0,0,0, 0,0,0,0, 1,0, 24,0};
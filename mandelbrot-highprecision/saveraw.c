@@ -0,0 +1,72 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: saveRaw
+ * Inputs: char *filename - the file name where the raw iteration field is to be saved
+ *         int *iterations - the memory block where the Julia set iterations are stored
+ *         float *smooth - the memory block where smooth escape values are stored; NULL if none
+ *         unsigned long int width - the width of the image
+ *         unsigned long int height - the height of the image
+ *         int maxIterations - the iteration limit the image was computed with
+ *         int flag - indicates if the image is Mandelbrot or Julia set
+ *         int my_rank - the id of the current process
+ *         MPI_Comm comm - the MPI communicator of the program
+ * -------------------------------------------------------------------------------------------------
+ * This function saves the iteration counts without reducing them to a palette index, so the image
+ * can be recoloured later without computing it again (see recolor.c). The file is a RawHeader
+ * followed by the iterations array and, if smooth is given, the smooth array. Both arrays are
+ * naturally aligned in the file, so a reader can use them in place through mmap.
+ *
+ * Every process must call this function, as the file is opened on the whole communicator, but
+ * the image is only complete on process 0 and process 0 writes it alone. Counts are in rows of a
+ * contiguous row type, so they stay within an int.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+#include <mpi.h>
+
+#include "julia.h"
+
+void saveRaw(char *filename, int *iterations, float *smooth, unsigned long int width, unsigned long int height, int maxIterations, int flag, int my_rank, MPI_Comm comm)
+{
+  MPI_File f;
+  RawHeader header;
+  MPI_Datatype intRow, floatRow;
+
+  if (MPI_File_open(comm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &f) != MPI_SUCCESS)
+  {
+    if (my_rank == 0) printf("Error opening raw file %s\n", filename);
+    return;
+  }
+  MPI_File_set_size(f, 0);
+
+  if (my_rank == 0)
+  {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RAWMAGIC, sizeof(header.magic));
+    header.version = RAWVERSION;
+    header.flags = (smooth != NULL) ? RAWSMOOTH : 0;
+    header.width = width;
+    header.height = height;
+    header.maxIterations = maxIterations;
+    header.flag = flag;
+    MPI_File_write_at(f, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+
+    MPI_Type_contiguous(width, MPI_INT, &intRow);
+    MPI_Type_commit(&intRow);
+    MPI_File_write_at(f, RAWHEADERSIZE, iterations, height, intRow, MPI_STATUS_IGNORE);
+    MPI_Type_free(&intRow);
+
+    if (smooth != NULL)
+    {
+      MPI_Type_contiguous(width, MPI_FLOAT, &floatRow);
+      MPI_Type_commit(&floatRow);
+      MPI_File_write_at(f, RAWHEADERSIZE + (MPI_Offset)sizeof(int) * width * height, smooth, height, floatRow, MPI_STATUS_IGNORE);
+      MPI_Type_free(&floatRow);
+    }
+  }
+
+  MPI_File_close(&f);
+}
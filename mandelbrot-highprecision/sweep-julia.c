@@ -0,0 +1,218 @@
+/*
+ * -------------------------------------------------------------------------------------------------
+ * Function: SweepJulia
+ * Inputs: mpf_t xmin, xmax - x coordinates of every thumbnail
+ *         mpf_t ymin, ymax - y coordinates of every thumbnail
+ *         int maxIterations - maximum number of hops to try to exit the unit circle
+ *         char *image - the file name of the atlas; .bmp extension
+ *         JuliaOptions *options - the c grid (-sweep), thumbnail size (-thumb) and -sweepdir
+ *         int my_rank - the id of the current process
+ *         int p - the total number of processes running
+ *         MPI_Comm comm - the MPI communicator of the program
+ * Outputs: long int totalCount - the number of iterations performed by the process
+ * -------------------------------------------------------------------------------------------------
+ * This function renders a grid of small Julia sets, one for each c on the grid given with -sweep,
+ * in a single run instead of one run per c value. Every thumbnail is a Julia set, whatever the flag
+ * in the parameter file says, since the c value is what the sweep varies.
+ *
+ * Thumbnails do not need the precision of the GMP kernel, so they are computed in double. The
+ * pixels of all thumbnails form one stream, and LANES consecutive pixels are iterated together
+ * with each lane carrying its own c, so a batch can straddle two thumbnails and no lane waits for
+ * a new image to start. Batches are shared between OpenMP threads, and tiles of TILE pixels are
+ * dealt round robin to the processes so the expensive c values are spread out.
+ *
+ * Process 0 gathers the tiles and saves either one atlas (thumbnail column i holds the i-th real
+ * part, row j the j-th imaginary part) or, with -sweepdir, one .bmp per thumbnail. It reports the
+ * throughput in thumbnails per second.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <gmp.h>
+#include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "julia.h"
+
+// Pixels iterated together, one c value per lane
+#define LANES 8
+
+// Pixels per tile dealt to a process
+#define TILE 4096
+
+/*
+ * Iterate LANES pixels at once. A lane stops counting once its z leaves the circle, the batch stops
+ * when every lane has left or maxIterations is reached. Returns the iterations counted.
+*/
+static long int iterateBatch(double *zr, double *zi, const double *cr, const double *ci, int maxIterations, int *out)
+{
+  int it[LANES];
+  int l, n, any = 1;
+  long int count = 0;
+
+  for (l = 0; l < LANES; l++) it[l] = 0;
+
+  for (n = 0; n < maxIterations && any; n++)
+  {
+    any = 0;
+#pragma omp simd reduction(|:any)
+    for (l = 0; l < LANES; l++)
+    {
+      double zr2 = zr[l] * zr[l];
+      double zi2 = zi[l] * zi[l];
+      int inside = (zr2 + zi2 < 4.0);
+      double nextImag = 2 * zr[l] * zi[l] + ci[l];
+
+      zr[l] = inside ? zr2 - zi2 + cr[l] : zr[l];
+      zi[l] = inside ? nextImag : zi[l];
+      it[l] += inside;
+      any |= inside;
+    }
+  }
+
+  for (l = 0; l < LANES; l++)
+  {
+    out[l] = it[l];
+    count += it[l];
+  }
+  return count;
+}
+
+long int SweepJulia(mpf_t xmin, mpf_t xmax, mpf_t ymin, mpf_t ymax, int maxIterations, char *image, JuliaOptions *options, int my_rank, int p, MPI_Comm comm)
+{
+  int ncr = options->sweepCount[0];
+  int nci = options->sweepCount[1];
+  long int thumb = options->thumb;
+  long int thumbPixels = thumb * thumb;
+  long int total = thumbPixels * ncr * nci;
+  long int tiles = (total + TILE - 1) / TILE;
+  long int myTiles = (tiles > my_rank) ? (tiles - my_rank + p - 1) / p : 0;
+  long int totalCount = 0;
+  long int t, k;
+  int i, j;
+  double t1, t2, maxTime;
+
+  // View and c grid in double
+  double x0 = mpf_get_d(xmin), y0 = mpf_get_d(ymin);
+  double xgap = (mpf_get_d(xmax) - x0) / thumb;
+  double ygap = (mpf_get_d(ymax) - y0) / thumb;
+  double crgap = (ncr > 1) ? (options->sweepMax[0] - options->sweepMin[0]) / (ncr - 1) : 0;
+  double cigap = (nci > 1) ? (options->sweepMax[1] - options->sweepMin[1]) / (nci - 1) : 0;
+
+  int *local = (int*)malloc(sizeof(int) * TILE * (myTiles > 0 ? myTiles : 1));
+  assert(local != NULL);
+
+  if (my_rank == 0)
+  {
+#ifdef _OPENMP
+    printf("Sweep: %d x %d values of c, %ldx%ld thumbnails, %d lanes, %d threads per process\n", ncr, nci, thumb, thumb, LANES, omp_get_max_threads());
+#else
+    printf("Sweep: %d x %d values of c, %ldx%ld thumbnails, %d lanes\n", ncr, nci, thumb, thumb, LANES);
+#endif
+  }
+
+  t1 = MPI_Wtime();
+
+  // My tiles are tiles my_rank, my_rank + p, ...; batches of a tile never cross into the next tile
+  long int batchesPerTile = TILE / LANES;
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:totalCount)
+  for (k = 0; k < myTiles * batchesPerTile; k++)
+  {
+    long int tile = my_rank + (k / batchesPerTile) * p;
+    long int first = tile * TILE + (k % batchesPerTile) * LANES;
+    double zr[LANES], zi[LANES], cr[LANES], ci[LANES];
+    int l;
+
+    for (l = 0; l < LANES; l++)
+    {
+      long int pixel = first + l;
+      if (pixel < total)
+      {
+        long int n = pixel / thumbPixels;
+        long int inside = pixel % thumbPixels;
+        zr[l] = x0 + (inside % thumb) * xgap;
+        zi[l] = y0 + (inside / thumb) * ygap;
+        cr[l] = options->sweepMin[0] + (n % ncr) * crgap;
+        ci[l] = options->sweepMin[1] + (n / ncr) * cigap;
+      }
+      else
+      {
+        // Padding lane, already outside the circle
+        zr[l] = 4.0;
+        zi[l] = cr[l] = ci[l] = 0.0;
+      }
+    }
+
+    totalCount += iterateBatch(zr, zi, cr, ci, maxIterations, local + (k / batchesPerTile) * TILE + (k % batchesPerTile) * LANES);
+  }
+
+  t2 = MPI_Wtime() - t1;
+  MPI_Reduce(&t2, &maxTime, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  // Gather all tiles; process r's buffer holds tiles r, r + p, ...
+  int *counts = NULL, *displ = NULL, *all = NULL;
+  int sendCount = TILE * myTiles;
+  if (my_rank == 0)
+  {
+    counts = (int*)malloc(sizeof(int) * p);
+    displ = (int*)malloc(sizeof(int) * p);
+    all = (int*)malloc(sizeof(int) * TILE * tiles);
+    assert(counts != NULL && displ != NULL && all != NULL);
+  }
+  MPI_Gather(&sendCount, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+  if (my_rank == 0)
+    for (i = 0; i < p; i++) displ[i] = (i == 0) ? 0 : displ[i - 1] + counts[i - 1];
+  MPI_Gatherv(local, sendCount, MPI_INT, all, counts, displ, MPI_INT, 0, comm);
+
+  if (my_rank == 0)
+  {
+    printf("Sweep: %d thumbnails in %lf s, %.1lf thumbnails per second\n", ncr * nci, maxTime, ncr * nci / maxTime);
+
+    // Put the tiles back in stream order
+    int *stream = (int*)malloc(sizeof(int) * TILE * tiles);
+    assert(stream != NULL);
+    for (t = 0; t < tiles; t++)
+      memcpy(stream + t * TILE, all + displ[t % p] + (t / p) * TILE, sizeof(int) * TILE);
+
+    if (options->sweepDir != NULL)
+    {
+      // One image per thumbnail
+      char filename[1024];
+      mkdir(options->sweepDir, 0755);
+      for (j = 0; j < nci; j++)
+        for (i = 0; i < ncr; i++)
+        {
+          snprintf(filename, sizeof(filename), "%s/thumb-%04d-%04d.bmp", options->sweepDir, j, i);
+          saveBMP(filename, stream + (j * ncr + i) * thumbPixels, thumb, thumb);
+        }
+      printf("Sweep: thumbnails saved in %s\n", options->sweepDir);
+    }
+    else
+    {
+      // One atlas of ncr x nci thumbnails
+      long int width = thumb * ncr;
+      int *atlas = (int*)malloc(sizeof(int) * total);
+      assert(atlas != NULL);
+      for (j = 0; j < nci; j++)
+        for (i = 0; i < ncr; i++)
+          for (t = 0; t < thumb; t++)
+            memcpy(atlas + (j * thumb + t) * width + i * thumb, stream + (j * ncr + i) * thumbPixels + t * thumb, sizeof(int) * thumb);
+      saveBMP(image, atlas, width, thumb * nci);
+      printf("Sweep: atlas saved in %s\n", image);
+      free(atlas);
+    }
+
+    free(stream);
+    free(counts);
+    free(displ);
+    free(all);
+  }
+
+  free(local);
+  return totalCount;
+}
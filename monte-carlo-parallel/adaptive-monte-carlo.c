@@ -0,0 +1,150 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// adaptive-monte-carlo.c
+
+// Monte Carlo integration that stops once the answer is good enough.
+// Every process draws batches of MC_CHUNK samples, batch k of round r being sample chunk
+// r*p + my_rank, and keeps the count, mean and sum of squared deviations of its values
+// (Welford, merged batch by batch with the formula of Chan et al.). Every mcOptions.every
+// batches the moments of all processes are combined with a nonblocking MPI_Iallreduce, which
+// completes while the next batches are computed. All processes test the same combined moments,
+// so they stop together: when the standard error is at most mcOptions.absTol, or at most
+// mcOptions.relTol times the estimate, when mcOptions.timeBudget seconds have passed, or when N
+// samples would be passed (at least one round of batches is always drawn). A last reduction
+// includes every sample drawn.
+// a, b, n, N, fcn, my_rank, p and com are as for parallelMonteCarlo.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "mpi.h"
+#include "monte-carlo.h"
+
+// moments of a set of samples, the layout reduced by mergeOp
+typedef struct
+{
+	double count;
+	double mean;
+	double m2;		// sum of squared deviations from the mean
+	double seconds;		// longest time spent by any process
+} Moments;
+
+#define MOMENTS_LENGTH 4
+
+// add the moments of b to a
+static void mergeMoments(Moments *a, const Moments *b)
+{
+	double count = a->count + b->count;
+	if (b->count > 0)
+	{
+		double delta = b->mean - a->mean;
+		a->mean += delta * b->count / count;
+		a->m2 += b->m2 + delta * delta * a->count * b->count / count;
+		a->count = count;
+	}
+	if (b->seconds > a->seconds)
+		a->seconds = b->seconds;
+}
+
+// MPI reduction operator over arrays of Moments
+static void mergeOp(void *in, void *inout, int *len, MPI_Datatype *type)
+{
+	for (int i = 0; i < *len / MOMENTS_LENGTH; i++)
+		mergeMoments((Moments*)inout + i, (Moments*)in + i);
+}
+
+// has the integration done enough
+static int finished(const Moments *global, long int N)
+{
+	if (global->count >= N)
+		return 1;
+	if (mcOptions.timeBudget > 0 && global->seconds >= mcOptions.timeBudget)
+		return 1;
+	if (global->count < 2 * MC_CHUNK)
+		return 0;
+
+	double error = sqrt(global->m2 / (global->count - 1) / global->count);
+	if (mcOptions.absTol > 0 && error <= mcOptions.absTol)
+		return 1;
+	if (mcOptions.relTol > 0 && error <= mcOptions.relTol * fabs(global->mean))
+		return 1;
+	return 0;
+}
+
+double adaptiveMonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com)
+{
+	Moments local = { 0, 0, 0, 0 }, snapshot, global;
+	MPI_Request request = MPI_REQUEST_NULL;
+	MPI_Op op;
+	double *u = (double*)malloc(MC_CHUNK*n*sizeof(double));
+	double *x = (double*)malloc(MC_CHUNK*n*sizeof(double));
+	double *f = (double*)malloc(MC_CHUNK*sizeof(double));
+	double t0 = MPI_Wtime();
+	long int round = 0;
+	int done = 0;
+
+	MPI_Op_create(mergeOp, 0, &op);
+
+	while (!done)
+	{
+		for (int k = 0; k < mcOptions.every; k++, round++)
+		{
+			unsigned long int chunk = round * p + my_rank;
+
+			rngUniform(u, (long int)MC_CHUNK*n, mcOptions.seed, chunk, 0);
+			if (mcOptions.sample != NULL)
+				mcOptions.sample(u, a, b, n, MC_CHUNK, f);
+			else
+			{
+				mapPoints(u, a, b, n, MC_CHUNK, x);
+				if (mcOptions.batch != NULL)
+					mcOptions.batch(x, n, MC_CHUNK, f);
+				else
+					scalarBatch(fcn, x, n, MC_CHUNK, f);
+			}
+
+			// moments of the batch, then into the running moments
+			Moments batch = { MC_CHUNK, 0, 0, 0 };
+			for (int i = 0; i < MC_CHUNK; i++)
+				batch.mean += f[i];
+			batch.mean /= MC_CHUNK;
+			for (int i = 0; i < MC_CHUNK; i++)
+				batch.m2 += (f[i] - batch.mean) * (f[i] - batch.mean);
+			mergeMoments(&local, &batch);
+		}
+		local.seconds = MPI_Wtime() - t0;
+
+		// the reduction started last time has overlapped with these batches
+		if (request != MPI_REQUEST_NULL)
+		{
+			MPI_Wait(&request, MPI_STATUS_IGNORE);
+			done = finished(&global, N);
+		}
+
+		// stop before the next round would go over N
+		if (!done && (round + mcOptions.every) * p * (double)MC_CHUNK > N)
+			done = 1;
+
+		if (!done)
+		{
+			snapshot = local;
+			MPI_Iallreduce(&snapshot, &global, MOMENTS_LENGTH, MPI_DOUBLE, op, com, &request);
+		}
+	}
+
+	// every sample drawn
+	MPI_Allreduce(&local, &global, MOMENTS_LENGTH, MPI_DOUBLE, op, com);
+	MPI_Op_free(&op);
+
+	if (my_rank == 0)
+	{
+		mcResult.error = (global.count > 1) ? sqrt(global.m2 / (global.count - 1) / global.count) : -1;
+		mcResult.samples = (long int)global.count;
+		mcResult.seconds = global.seconds;
+	}
+
+	free(u);
+	free(x);
+	free(f);
+	return global.mean;
+}
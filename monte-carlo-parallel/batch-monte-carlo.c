@@ -0,0 +1,225 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// batch-monte-carlo.c
+
+// Many integrals from one sampling pass.
+// A job is an integrand of integrands.c over a box [a, b]. All jobs of the same dimension use
+// the same N uniform points of the unit cube, drawn once per chunk and mapped affinely onto the
+// box of every job, so the random numbers are generated once for the whole batch. Sample s comes
+// from stream s/MC_CHUNK as in MonteCarlo, so every job sees the points a1 would use for it alone.
+// The chunks are split between the processes as in parallelMonteCarlo and between the OpenMP
+// threads statically; each thread keeps compensated sums of f and f^2 for every job, added in
+// thread order. One MPI_Reduce of the vector of all sums gives every estimate and its standard
+// error on process 0, stored in the jobs.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "mpi.h"
+#include "monte-carlo.h"
+
+// longest line of a job list
+#define JOB_LINE 4096
+
+// sums kept per job: sum of f and its compensation, sum of f^2 and its compensation
+#define JOB_SUMS 4
+
+// Read the jobs of a job list, one per line: integrand name, dimension n, a_1 .. a_n, b_1 .. b_n.
+// Empty lines and lines starting with # are skipped.
+// returns the number of jobs, or -1 if the file cannot be read or a line is wrong
+int readJobs(const char *path, IntegralJob **jobs)
+{
+	FILE *file = fopen(path, "r");
+	char line[JOB_LINE];
+	int count = 0, size = 16, number = 0;
+
+	if (file == NULL)
+	{
+		printf("Cannot open job list %s\n", path);
+		return -1;
+	}
+	*jobs = (IntegralJob*)malloc(size*sizeof(IntegralJob));
+
+	while (fgets(line, JOB_LINE, file) != NULL)
+	{
+		char name[64];
+		int n, used, ok = 1;
+		char *s = line;
+
+		number++;
+		while (*s == ' ' || *s == '\t')
+			s++;
+		if (*s == '#' || *s == '\n' || *s == '\r' || *s == '\0')
+			continue;
+
+		if (sscanf(s, "%63s %d%n", name, &n, &used) != 2 || n < 1 || findIntegrand(name) == NULL)
+			ok = 0;
+		else
+		{
+			if (count == size)
+			{
+				size *= 2;
+				*jobs = (IntegralJob*)realloc(*jobs, size*sizeof(IntegralJob));
+			}
+			IntegralJob *job = *jobs + count;
+			job->integrand = findIntegrand(name);
+			job->n = n;
+			job->a = (double*)malloc(n*sizeof(double));
+			job->b = (double*)malloc(n*sizeof(double));
+			job->estimate = 0;
+			job->error = -1;
+
+			s += used;
+			for (int j = 0; j < 2*n && ok; j++)
+			{
+				double *bound = (j < n) ? job->a + j : job->b + j - n;
+				if (sscanf(s, "%lf%n", bound, &used) != 1)
+					ok = 0;
+				s += used;
+			}
+			if (ok)
+				count++;
+			else
+			{
+				free(job->a);
+				free(job->b);
+			}
+		}
+
+		if (!ok)
+		{
+			printf("Job list %s, line %d: expected integrand n a_1 .. a_n b_1 .. b_n\n", path, number);
+			fclose(file);
+			freeJobs(*jobs, count);
+			return -1;
+		}
+	}
+
+	fclose(file);
+	return count;
+}
+
+void freeJobs(IntegralJob *jobs, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		free(jobs[i].a);
+		free(jobs[i].b);
+	}
+	free(jobs);
+}
+
+// Add f of count points to the sums of one job
+static void addSums(double *sums, const double *f, int count)
+{
+	for (int k = 0; k < count; k++)
+	{
+		neumaierAdd(&sums[0], &sums[1], f[k]);
+		neumaierAdd(&sums[2], &sums[3], f[k] * f[k]);
+	}
+}
+
+// Estimate every job with N samples; the results are stored in the jobs on process 0.
+// Jobs use mcOptions.seed, the block version and sampling kernel of their integrand unless scalar
+// is set.
+void batchMonteCarlo(IntegralJob *jobs, int count, long int N, int scalar, int my_rank, int p, MPI_Comm com)
+{
+	int threads = omp_get_max_threads();
+	int size = JOB_SUMS*count;
+	double *threadSums = (double*)calloc((long int)threads*size, sizeof(double));
+	double *local = (double*)calloc(size, sizeof(double));
+	double *global = (double*)calloc(size, sizeof(double));
+	int *group = (int*)malloc(count*sizeof(int));
+
+	// my whole chunks of the N samples, as the static split of parallelMonteCarlo
+	long int chunks = (N + MC_CHUNK - 1) / MC_CHUNK;
+	long int firstChunk = SHARE_FIRST(chunks, my_rank, p);
+	long int myChunks = SHARE(chunks, my_rank, p);
+
+	// one sampling pass per dimension, over every job of that dimension
+	for (int i = 0; i < count; i++)
+	{
+		int n = jobs[i].n, members = 0;
+		int seen = 0;
+		for (int k = 0; k < i; k++)
+			if (jobs[k].n == n)
+				seen = 1;
+		if (seen)
+			continue;
+		for (int k = i; k < count; k++)
+			if (jobs[k].n == n)
+				group[members++] = k;
+
+#pragma omp parallel
+		{
+			double *sums = threadSums + (long int)omp_get_thread_num()*size;
+			double *u = (double*)malloc(MC_CHUNK*n*sizeof(double));
+			double *x = (double*)malloc(MC_CHUNK*n*sizeof(double));
+			double *f = (double*)malloc(MC_CHUNK*sizeof(double));
+
+#pragma omp for schedule(static)
+			for (long int c = firstChunk; c < firstChunk + myChunks; c++)
+			{
+				int points = (N - c*MC_CHUNK < MC_CHUNK) ? N - c*MC_CHUNK : MC_CHUNK;
+
+				// the uniforms of this chunk, shared by all jobs of the dimension
+				rngUniform(u, (long int)points*n, mcOptions.seed, c, 0);
+
+				for (int m = 0; m < members; m++)
+				{
+					IntegralJob *job = jobs + group[m];
+					Integrand *integrand = job->integrand;
+
+					if (!scalar && integrand->kernel != NULL && integrand->kernel(n) != NULL)
+						integrand->kernel(n)(u, job->a, job->b, n, points, f);
+					else
+					{
+						mapPoints(u, job->a, job->b, n, points, x);
+						if (!scalar && integrand->batch != NULL)
+							integrand->batch(x, n, points, f);
+						else
+							scalarBatch(integrand->fcn, x, n, points, f);
+					}
+					addSums(sums + JOB_SUMS*group[m], f, points);
+				}
+			}
+
+			free(u);
+			free(x);
+			free(f);
+		}
+	}
+
+	// threads in order, so the sums only depend on the number of threads
+	for (int t = 0; t < threads; t++)
+		for (int i = 0; i < count; i++)
+		{
+			double *sums = threadSums + (long int)t*size + JOB_SUMS*i;
+			neumaierAdd(&local[JOB_SUMS*i], &local[JOB_SUMS*i + 1], sums[0] + sums[1]);
+			neumaierAdd(&local[JOB_SUMS*i + 2], &local[JOB_SUMS*i + 3], sums[2] + sums[3]);
+		}
+
+	// every job in one reduction
+	MPI_Reduce(local, global, size, MPI_DOUBLE, MPI_SUM, 0, com);
+
+	if (my_rank == 0)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			double sum = global[JOB_SUMS*i] + global[JOB_SUMS*i + 1];
+			double squares = global[JOB_SUMS*i + 2] + global[JOB_SUMS*i + 3];
+			double mean = sum / N;
+			double variance = squares / N - mean * mean;
+			jobs[i].estimate = mean;
+			jobs[i].error = (N > 1) ? sqrt((variance > 0 ? variance : 0) / (N - 1)) : -1;
+		}
+		mcResult.samples = N;
+	}
+
+	free(threadSums);
+	free(local);
+	free(global);
+	free(group);
+}
@@ -0,0 +1,173 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// bench.c
+
+// Accuracy and speed benchmark of the integrator.
+// Runs every test integrand of integrands.c over the unit cube for every dimension, sampling mode
+// and sample count asked for, and prints one record per run on process 0: the estimate, the
+// closed form reference, the absolute and standard errors, the wall time, samples per second and
+// the efficiency |error| * sqrt(time) (smaller is better). bench.sh repeats it for several
+// process counts.
+//
+// usage: bench [-integrands name,...] [-dims 1,2,...] [-modes mc,qmc,vegas] [-N 1e5,...]
+//              [-format csv|json] [-seed s]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "mpi.h"
+#include "monte-carlo.h"
+
+extern double parallelMonteCarlo (double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com);
+extern double checkResult(double integral, double *a, double *b, int n, long int N, double (*fcn)(double *x, int n));
+
+#define MAXLIST 64
+
+static const char *modeNames[] = { "mc", "qmc", "vegas" };
+
+// split a comma separated list in place, returns the number of items
+static int splitList(char *list, char **items)
+{
+	int count = 0;
+	for (char *item = strtok(list, ","); item != NULL && count < MAXLIST; item = strtok(NULL, ","))
+		items[count++] = item;
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	int my_rank, p, provided;
+	char defaultDims[] = "1,2,4,8", defaultModes[] = "mc,qmc,vegas", defaultN[] = "100000,1000000";
+	char *dimList = defaultDims, *modeList = defaultModes, *NList = defaultN, *integrandList = NULL;
+	int json = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-integrands") == 0 && i + 1 < argc)
+			integrandList = argv[++i];
+		else if (strcmp(argv[i], "-dims") == 0 && i + 1 < argc)
+			dimList = argv[++i];
+		else if (strcmp(argv[i], "-modes") == 0 && i + 1 < argc)
+			modeList = argv[++i];
+		else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc)
+			NList = argv[++i];
+		else if (strcmp(argv[i], "-format") == 0 && i + 1 < argc)
+			json = (strcmp(argv[++i], "json") == 0);
+		else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+			mcOptions.seed = strtoul(argv[++i], NULL, 0);
+		else
+			printf("Ignoring unknown option %s\n", argv[i]);
+	}
+
+	char *dims[MAXLIST], *modes[MAXLIST], *Ns[MAXLIST], *names[MAXLIST];
+	int nDims = splitList(dimList, dims);
+	int nModes = splitList(modeList, modes);
+	int nN = splitList(NList, Ns);
+	int nIntegrands = 0;
+	if (integrandList != NULL)
+		nIntegrands = splitList(integrandList, names);
+	else
+		for (Integrand *t = mcIntegrands; t->name != NULL && nIntegrands < MAXLIST; t++)
+			names[nIntegrands++] = (char*)t->name;
+
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+	mcOptions.progress = 0;
+	mcOptions.verbose = 0;
+
+	if (my_rank == 0)
+	{
+		if (json)
+			printf("[\n");
+		else
+			printf("integrand,dim,mode,processes,threads,N,samples,estimate,reference,abs_error,std_error,seconds,samples_per_s,efficiency\n");
+	}
+
+	int records = 0;
+	for (int t = 0; t < nIntegrands; t++)
+	{
+		Integrand *integrand = findIntegrand(names[t]);
+		if (integrand == NULL)
+		{
+			if (my_rank == 0)
+				fprintf(stderr, "Unknown integrand %s\n", names[t]);
+			continue;
+		}
+
+		for (int d = 0; d < nDims; d++)
+		{
+			int n = atoi(dims[d]);
+			double *a = (double*)malloc(n*sizeof(double));
+			double *b = (double*)malloc(n*sizeof(double));
+			for (int j = 0; j < n; j++)
+			{
+				a[j] = 0;
+				b[j] = 1;
+			}
+
+			for (int m = 0; m < nModes; m++)
+			{
+				int mode = -1;
+				for (int k = 0; k < 3; k++)
+					if (strcmp(modes[m], modeNames[k]) == 0)
+						mode = k;
+				if (mode < 0)
+				{
+					if (my_rank == 0 && t == 0 && d == 0)
+						fprintf(stderr, "Unknown mode %s\n", modes[m]);
+					continue;
+				}
+
+				for (int k = 0; k < nN; k++)
+				{
+					long int N = (long int)atof(Ns[k]);
+
+					mcOptions.mode = (mode == 0) ? MC_RANDOM : (mode == 1) ? MC_QMC : MC_VEGAS;
+					mcOptions.batch = integrand->batch;
+					mcOptions.sample = (integrand->kernel != NULL) ? integrand->kernel(n) : NULL;
+					mcResult.error = -1;
+					mcResult.samples = N;
+
+					MPI_Barrier(MPI_COMM_WORLD);
+					double t0 = MPI_Wtime();
+					double estimate = parallelMonteCarlo(a, b, n, N, integrand->fcn, my_rank, p, MPI_COMM_WORLD);
+					double elapsed = MPI_Wtime() - t0, seconds;
+					MPI_Reduce(&elapsed, &seconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+					if (my_rank == 0)
+					{
+						double reference = integrand->exact(a, b, n);
+						double error = checkResult(estimate, a, b, n, N, integrand->fcn);
+						double rate = mcResult.samples / seconds;
+						double efficiency = error * sqrt(seconds);
+
+						if (json)
+							printf("%s  {\"integrand\": \"%s\", \"dim\": %d, \"mode\": \"%s\", \"processes\": %d, \"threads\": %d, \"N\": %ld, \"samples\": %ld, "
+								"\"estimate\": %.15e, \"reference\": %.15e, \"abs_error\": %.6e, \"std_error\": %.6e, \"seconds\": %.6f, \"samples_per_s\": %.6e, \"efficiency\": %.6e}",
+								records ? ",\n" : "", integrand->name, n, modeNames[mode], p, omp_get_max_threads(), N, mcResult.samples,
+								estimate, reference, error, mcResult.error, seconds, rate, efficiency);
+						else
+							printf("%s,%d,%s,%d,%d,%ld,%ld,%.15e,%.15e,%.6e,%.6e,%.6f,%.6e,%.6e\n",
+								integrand->name, n, modeNames[mode], p, omp_get_max_threads(), N, mcResult.samples,
+								estimate, reference, error, mcResult.error, seconds, rate, efficiency);
+						fflush(stdout);
+					}
+					records++;
+				}
+			}
+
+			free(a);
+			free(b);
+		}
+	}
+
+	if (my_rank == 0 && json)
+		printf("\n]\n");
+
+	MPI_Finalize();
+	return 0;
+}
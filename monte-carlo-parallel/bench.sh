@@ -0,0 +1,23 @@
+#!/bin/sh
+# Aimal Khan SE4F03 Assignment 1
+
+# bench.sh
+# Runs the benchmark for several process counts and joins the CSV records.
+# usage: ./bench.sh "1 2 4" [bench options]
+# MPIRUN overrides the launcher, e.g. MPIRUN="mpirun --oversubscribe"
+
+MPIRUN=${MPIRUN:-mpirun}
+PROCESSES=${1:-"1 2 4"}
+[ $# -gt 0 ] && shift
+HEADER=1
+
+for P in $PROCESSES
+do
+	if [ $HEADER = 1 ]
+	then
+		$MPIRUN -np $P ./bench "$@"
+		HEADER=0
+	else
+		$MPIRUN -np $P ./bench "$@" | tail -n +2
+	fi
+done
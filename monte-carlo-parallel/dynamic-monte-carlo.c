@@ -0,0 +1,98 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// dynamic-monte-carlo.c
+
+// Monte Carlo integration with the blocks handed out on demand, for integrands whose cost varies
+// over the box or processes of different speeds.
+// The samples are cut in the same blocks of whole MC_CHUNK chunks as the static split of
+// parallelMonteCarlo. A counter in a window of process 0 holds the next free block; each process
+// claims as many blocks as it has OpenMP threads with one MPI_Fetch_and_op, sums them in
+// parallel and comes back for more until none are left. Every block sum is stored at its block
+// index with its sum of squares, and one MPI_Reduce collects both on process 0 (every block is
+// summed by exactly one process, the others add zeros), which adds the sums with the same
+// pairwise tree as the static split and the squares for the standard error. Blocks use streams
+// by sample index, so the result is the same to the bit as the static split, whoever summed
+// which block.
+// a, b, n, N, fcn, my_rank, p and com are as for parallelMonteCarlo.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "mpi.h"
+#include "monte-carlo.h"
+
+extern double MonteCarlo(double *a, double *b, int n, long int first, long int N, double (*fcn)(double *x, int n), BatchFcn batch, SampleFcn sample, unsigned long int seed, double *squares);
+
+double dynamicMonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com)
+{
+	// same blocks as the static split
+	long int chunks = (N + MC_CHUNK - 1) / MC_CHUNK;
+	long int perBlock = (chunks + MC_MAXBLOCKS - 1) / MC_MAXBLOCKS;
+	long int blockSamples = perBlock * MC_CHUNK;
+	long int blocks = (chunks + perBlock - 1) / perBlock;
+
+	// block sums of f, then of f^2
+	double *sums = (double*)calloc(2*blocks, sizeof(double));
+	double *allSums = (my_rank == 0) ? (double*)malloc(2*blocks*sizeof(double)) : NULL;
+	double totalSum = 0;
+
+	// next free block, in the window of process 0
+	long int *counter;
+	MPI_Win win;
+	MPI_Win_allocate((my_rank == 0) ? sizeof(long int) : 0, sizeof(long int), MPI_INFO_NULL, com, &counter, &win);
+	if (my_rank == 0)
+		*counter = 0;
+	MPI_Barrier(com);
+
+	long int grab = omp_get_max_threads();
+	long int taken = 0;
+	double start = MPI_Wtime();
+
+	MPI_Win_lock_all(0, win);
+	while (1)
+	{
+		long int next;
+		MPI_Fetch_and_op(&grab, &next, MPI_LONG, 0, 0, MPI_SUM, win);
+		MPI_Win_flush(0, win);
+		if (next >= blocks)
+			break;
+
+		long int last = (next + grab < blocks) ? next + grab : blocks;
+#pragma omp parallel for schedule(dynamic)
+		for (long int k = next; k < last; k++)
+		{
+			long int first = k * blockSamples;
+			long int count = (N - first < blockSamples) ? N - first : blockSamples;
+			sums[k] = MonteCarlo(a, b, n, first, count, fcn, mcOptions.batch, mcOptions.sample, mcOptions.seed, sums + blocks + k);
+		}
+		taken += last - next;
+	}
+	MPI_Win_unlock_all(win);
+
+	// how the blocks went, process by process
+	double mine[2] = { (double)taken, MPI_Wtime() - start };
+	double *work = (my_rank == 0) ? (double*)malloc(2*p*sizeof(double)) : NULL;
+	MPI_Gather(mine, 2, MPI_DOUBLE, work, 2, MPI_DOUBLE, 0, com);
+
+	MPI_Reduce(sums, allSums, 2*blocks, MPI_DOUBLE, MPI_SUM, 0, com);
+
+	if (my_rank == 0)
+	{
+		totalSum = pairwiseSum(allSums, blocks) / N;
+		double variance = pairwiseSum(allSums + blocks, blocks) / N - totalSum * totalSum;
+		mcResult.error = (N > 1) ? sqrt((variance > 0 ? variance : 0) / (N - 1)) : -1;
+		mcResult.samples = N;
+
+		if (mcOptions.verbose)
+			for (int source = 0; source < p; source++)
+				printf("Process %d: %.0f of %ld blocks in %.3f s\n", source, work[2*source], blocks, work[2*source + 1]);
+	}
+
+	MPI_Win_free(&win);
+	free(sums);
+	free(allSums);
+	free(work);
+	return totalSum;
+}
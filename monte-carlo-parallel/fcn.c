@@ -3,6 +3,8 @@
 // fcn.c
 
 #include <math.h>
+#include "monte-carlo.h"
+
 double fcn(double *x, int n)
 {
 	double pi = 3.14159265358979;
@@ -15,4 +17,128 @@ double fcn(double *x, int n)
 	return r;
 }
 
+// Largest |w| the polynomial sincos below is used for
+#define SINCOS_LIMIT 1.0e5
+
+// sin and cos of x for |x| <= SINCOS_LIMIT without calls or branches, so it vectorizes.
+// x is reduced to r in [-pi/4, pi/4] with pi/2 split in three parts (Cody-Waite), then the
+// fdlibm kernel polynomials give sin(r) and cos(r), swapped and negated by quadrant.
+#pragma omp declare simd
+static inline void sincosKernel(double x, double *s, double *c)
+{
+	const double twoOverPi = 6.36619772367581382433e-01;
+	const double pio2_1 = 1.57079632673412561417e+00;
+	const double pio2_2 = 6.07710050630396597660e-11;
+	const double pio2_3 = 2.02226624879595063154e-21;
+
+	int q = (int)(x * twoOverPi + (x >= 0 ? 0.5 : -0.5));
+	double fq = (double)q;
+	double r = ((x - fq * pio2_1) - fq * pio2_2) - fq * pio2_3;
+	double z = r * r;
+
+	double sr = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+		z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+		z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+	double cr = 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 +
+		z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07 +
+		z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+
+	// quadrant 1 and 3 swap sin and cos, quadrants 2 and 3 negate sin, 1 and 2 negate cos
+	double ss = (q & 1) ? cr : sr;
+	double cc = (q & 1) ? sr : cr;
+	*s = ((q & 2) ? -ss : ss);
+	*c = (((q + 1) & 2) ? -cc : cc);
+}
+
+// Values of the integrand from w = k * x_1 * ... * x_n, in place
+static inline void fcnValues(double *f, int count)
+{
+	double pi = 3.14159265358979;
+	double k = pi/2;
+	int i;
+
+	// the polynomial sincos only covers |w| <= SINCOS_LIMIT, use libm for a block that goes beyond
+	for (i = 0; i < count; i++)
+		if (!(fabs(f[i]) <= SINCOS_LIMIT))
+			break;
+	if (i < count)
+	{
+		for (i = 0; i < count; i++)
+		{
+			double w = f[i];
+			f[i] = k*cos(w)-7*k*w*sin(w)-6*k*w*w*cos(w)+k*w*w*w*sin(w);
+		}
+		return;
+	}
+
+#pragma omp simd
+	for (i = 0; i < count; i++)
+	{
+		double w = f[i];
+		double s, c;
+		sincosKernel(w, &s, &c);
+		f[i] = k*c-7*k*w*s-6*k*w*w*c+k*w*w*w*s;
+	}
+}
 
+// Same integrand as fcn for a block of count points.
+// x holds the points dimension by dimension: x[j*count + i] is coordinate j of point i.
+// f receives the count function values.
+void fcnBatch(double *x, int n, int count, double *f)
+{
+	double pi = 3.14159265358979;
+	double k = pi/2;
+	int i, j;
+
+	// w = k * x_1 * ... * x_n, one dimension at a time over the whole block
+	for (i = 0; i < count; i++)
+		f[i] = k;
+	for (j = 0; j < n; j++)
+	{
+		double *xj = x + (long int)j*count;
+#pragma omp simd
+		for (i = 0; i < count; i++)
+			f[i] *= xj[i];
+	}
+
+	fcnValues(f, count);
+}
+
+// Sampling kernel of fcn for N dimensions (see SampleFcn): every point is mapped into the box and
+// multiplied into w in one pass over its uniforms, with the loop over the dimensions unrolled, so
+// the points are never stored. The coordinates and products are the ones of mapPoints and
+// fcnBatch, so the values are the same to the bit.
+#define FCN_KERNEL(N) \
+static void fcnSample##N(const double *u, const double *a, const double *b, int n, int count, double *f) \
+{ \
+	double width[N]; \
+	for (int j = 0; j < N; j++) \
+		width[j] = b[j] - a[j]; \
+	_Pragma("omp simd") \
+	for (int i = 0; i < count; i++) \
+	{ \
+		double w = 3.14159265358979/2; \
+		_Pragma("GCC unroll 16") \
+		for (int j = 0; j < N; j++) \
+			w *= a[j] + u[(long int)i*N + j] * width[j]; \
+		f[i] = w; \
+	} \
+	fcnValues(f, count); \
+}
+
+FCN_KERNEL(1) FCN_KERNEL(2) FCN_KERNEL(3) FCN_KERNEL(4)
+FCN_KERNEL(5) FCN_KERNEL(6) FCN_KERNEL(7) FCN_KERNEL(8)
+FCN_KERNEL(9) FCN_KERNEL(10) FCN_KERNEL(11) FCN_KERNEL(12)
+FCN_KERNEL(13) FCN_KERNEL(14) FCN_KERNEL(15) FCN_KERNEL(16)
+
+static const SampleFcn fcnKernels[MC_KERNELS + 1] =
+{
+	NULL, fcnSample1, fcnSample2, fcnSample3, fcnSample4, fcnSample5, fcnSample6, fcnSample7, fcnSample8,
+	fcnSample9, fcnSample10, fcnSample11, fcnSample12, fcnSample13, fcnSample14, fcnSample15, fcnSample16
+};
+
+// sampling kernel of fcn for dimension n, NULL above MC_KERNELS where mapPoints and fcnBatch are used
+SampleFcn fcnKernel(int n)
+{
+	return (n >= 1 && n <= MC_KERNELS) ? fcnKernels[n] : NULL;
+}
@@ -0,0 +1,263 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// integrands.c
+
+// Test integrands with closed form integrals, used by checkResult and the benchmark.
+// The Genz families (oscillatory, product peak, corner peak, Gaussian, continuous and
+// discontinuous) have coefficients c_j = h/n, so the difficulty h does not change with the
+// dimension, and centres w_j fixed in (0.2, 0.8). Every reference is the mean of the integrand
+// over the box [a, b], which is what parallelMonteCarlo returns, not the integral itself.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "monte-carlo.h"
+
+extern double fcn(double *x, int n);
+
+// Genz difficulties
+#define H_OSCILLATORY 9.0
+#define H_PRODUCTPEAK 7.25
+#define H_CORNERPEAK 1.85
+#define H_GAUSSIAN 7.03
+#define H_CONTINUOUS 20.4
+#define H_DISCONTINUOUS 4.3
+
+#define PI 3.14159265358979323846
+
+// centre of dimension j
+static double centre(int j)
+{
+	double g = (j + 1) * 0.6180339887498949;
+	return 0.2 + 0.6 * (g - floor(g));
+}
+
+static double volume(double *a, double *b, int n)
+{
+	double v = 1;
+	for (int j = 0; j < n; j++)
+		v *= b[j] - a[j];
+	return v;
+}
+
+// separable: prod (pi/2) sin(pi x_j), mean 1 over the unit cube
+static double separable(double *x, int n)
+{
+	double f = 1;
+	for (int j = 0; j < n; j++)
+		f *= PI / 2 * sin(PI * x[j]);
+	return f;
+}
+
+static double separableExact(double *a, double *b, int n)
+{
+	double v = 1;
+	for (int j = 0; j < n; j++)
+		v *= (cos(PI * a[j]) - cos(PI * b[j])) / 2;
+	return v / volume(a, b, n);
+}
+
+// oscillatory: cos(2 pi w_1 + sum c_j x_j)
+static double oscillatory(double *x, int n)
+{
+	double s = 2 * PI * centre(0);
+	for (int j = 0; j < n; j++)
+		s += H_OSCILLATORY / n * x[j];
+	return cos(s);
+}
+
+static double oscillatoryExact(double *a, double *b, int n)
+{
+	// real part of e^(i 2 pi w_1) prod (e^(i c b) - e^(i c a)) / (i c)
+	double complex v = cexp(I * 2 * PI * centre(0));
+	double c = H_OSCILLATORY / n;
+	for (int j = 0; j < n; j++)
+		v *= (cexp(I * c * b[j]) - cexp(I * c * a[j])) / (I * c);
+	return creal(v) / volume(a, b, n);
+}
+
+// product peak: prod 1 / (c^-2 + (x_j - w_j)^2)
+static double productPeak(double *x, int n)
+{
+	double c = H_PRODUCTPEAK / n, f = 1;
+	for (int j = 0; j < n; j++)
+		f /= 1 / (c * c) + (x[j] - centre(j)) * (x[j] - centre(j));
+	return f;
+}
+
+static double productPeakExact(double *a, double *b, int n)
+{
+	double c = H_PRODUCTPEAK / n, v = 1;
+	for (int j = 0; j < n; j++)
+		v *= c * (atan(c * (b[j] - centre(j))) - atan(c * (a[j] - centre(j))));
+	return v / volume(a, b, n);
+}
+
+// corner peak: (1 + sum c_j x_j)^-(n+1), for boxes where 1 + sum c_j x_j > 0
+static double cornerPeak(double *x, int n)
+{
+	double s = 1;
+	for (int j = 0; j < n; j++)
+		s += H_CORNERPEAK / n * x[j];
+	return pow(s, -(n + 1));
+}
+
+static double cornerPeakExact(double *a, double *b, int n)
+{
+	// n integrations give (-1)^n / (n! prod c) (1 + sum c x)^-1, summed over the corners of the box
+	double c = H_CORNERPEAK / n, scale = 1, v = 0;
+	for (int j = 0; j < n; j++)
+		scale *= -(j + 1) * c;
+
+	for (long int corner = 0; corner < (1L << n); corner++)
+	{
+		double s = 1;
+		int lower = 0;
+		for (int j = 0; j < n; j++)
+		{
+			if ((corner >> j) & 1)
+			{
+				s += c * a[j];
+				lower++;
+			}
+			else
+				s += c * b[j];
+		}
+		v += ((lower & 1) ? -1 : 1) / s;
+	}
+	return v / scale / volume(a, b, n);
+}
+
+// Gaussian: exp(-sum c^2 (x_j - w_j)^2)
+static double gaussian(double *x, int n)
+{
+	double c = H_GAUSSIAN / n, s = 0;
+	for (int j = 0; j < n; j++)
+		s += c * c * (x[j] - centre(j)) * (x[j] - centre(j));
+	return exp(-s);
+}
+
+static double gaussianExact(double *a, double *b, int n)
+{
+	double c = H_GAUSSIAN / n, v = 1;
+	for (int j = 0; j < n; j++)
+		v *= sqrt(PI) / (2 * c) * (erf(c * (b[j] - centre(j))) - erf(c * (a[j] - centre(j))));
+	return v / volume(a, b, n);
+}
+
+// continuous: exp(-sum c |x_j - w_j|), a kink at the centre
+static double continuous(double *x, int n)
+{
+	double c = H_CONTINUOUS / n, s = 0;
+	for (int j = 0; j < n; j++)
+		s += c * fabs(x[j] - centre(j));
+	return exp(-s);
+}
+
+// integral of exp(-c |x - w|) from w to t
+static double continuousPart(double t, double w, double c)
+{
+	return (t >= w ? 1 : -1) * (1 - exp(-c * fabs(t - w))) / c;
+}
+
+static double continuousExact(double *a, double *b, int n)
+{
+	double c = H_CONTINUOUS / n, v = 1;
+	for (int j = 0; j < n; j++)
+		v *= continuousPart(b[j], centre(j), c) - continuousPart(a[j], centre(j), c);
+	return v / volume(a, b, n);
+}
+
+// discontinuous: exp(sum c x_j) where x_1 <= w_1 and x_2 <= w_2, 0 elsewhere
+static double discontinuous(double *x, int n)
+{
+	double c = H_DISCONTINUOUS / n, s = 0;
+	for (int j = 0; j < n && j < 2; j++)
+		if (x[j] > centre(j))
+			return 0;
+	for (int j = 0; j < n; j++)
+		s += c * x[j];
+	return exp(s);
+}
+
+static double discontinuousExact(double *a, double *b, int n)
+{
+	double c = H_DISCONTINUOUS / n, v = 1;
+	for (int j = 0; j < n; j++)
+	{
+		double top = (j < 2 && centre(j) < b[j]) ? centre(j) : b[j];
+		v *= (top > a[j]) ? (exp(c * top) - exp(c * a[j])) / c : 0;
+	}
+	return v / volume(a, b, n);
+}
+
+// fcn is k T^3 cos(w) with w = k x_1 ... x_n, k = pi/2 and T = 1 + w d/dw. Over [0, v] the
+// integral is prod v_j * k (T^(3-n) cos)(k prod v_j), and T^m acts on w^i as (1+i)^m, so the
+// cosine series gives it for any n. Boxes follow by adding the corners with signs.
+static double fcnCorner(double *v, int n)
+{
+	double k = PI / 2, product = 1;
+	for (int j = 0; j < n; j++)
+		product *= v[j];
+
+	double w = k * product, term = 1, series = 0;
+	for (int i = 0; i < 200 && (i < 4 || fabs(term) > 1e-18); i += 2)
+	{
+		if (i > 0)
+			term *= -w * w / ((i - 1) * i);
+		series += term * pow(1 + i, 3 - n);
+	}
+	return product * k * series;
+}
+
+static double fcnExact(double *a, double *b, int n)
+{
+	double *v = (double*)malloc(n * sizeof(double));
+	double sum = 0;
+
+	for (long int corner = 0; corner < (1L << n); corner++)
+	{
+		int lower = 0;
+		for (int j = 0; j < n; j++)
+		{
+			v[j] = ((corner >> j) & 1) ? a[j] : b[j];
+			lower += (corner >> j) & 1;
+		}
+		sum += ((lower & 1) ? -1 : 1) * fcnCorner(v, n);
+	}
+
+	free(v);
+	return sum / volume(a, b, n);
+}
+
+Integrand mcIntegrands[] =
+{
+	{ "fcn", fcn, fcnBatch, fcnKernel, fcnExact },
+	{ "separable", separable, NULL, NULL, separableExact },
+	{ "oscillatory", oscillatory, NULL, NULL, oscillatoryExact },
+	{ "productpeak", productPeak, NULL, NULL, productPeakExact },
+	{ "cornerpeak", cornerPeak, NULL, NULL, cornerPeakExact },
+	{ "gaussian", gaussian, NULL, NULL, gaussianExact },
+	{ "continuous", continuous, NULL, NULL, continuousExact },
+	{ "discontinuous", discontinuous, NULL, NULL, discontinuousExact },
+	{ NULL, NULL, NULL, NULL, NULL }
+};
+
+// the integrand called name, or NULL
+Integrand *findIntegrand(const char *name)
+{
+	for (Integrand *t = mcIntegrands; t->name != NULL; t++)
+		if (strcmp(t->name, name) == 0)
+			return t;
+	return NULL;
+}
+
+// the integrand whose point by point function is f, or NULL
+Integrand *integrandOf(double (*f)(double *x, int n))
+{
+	for (Integrand *t = mcIntegrands; t->name != NULL; t++)
+		if (t->fcn == f)
+			return t;
+	return NULL;
+}
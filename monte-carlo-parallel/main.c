@@ -4,7 +4,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
 #include "mpi.h"
+#include "monte-carlo.h"
 
 extern double fcn(double *x, int n);
 extern double parallelMonteCarlo (double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com);
@@ -18,10 +22,16 @@ int main(int argc, char *argv[])
 	// Integral value to be returned
 	double integral;
 
+	// a1 -jobs file [options] N integrates every job of the list in one pass (see batch-monte-carlo.c)
+	char *jobList = (argc > 3 && strcmp(argv[1], "-jobs") == 0) ? argv[2] : NULL;
+
 	// # of dimensions
-	int n = atof(argv[1]);
-	// # of integration points
-	int N = atof(argv[argc - 1]);
+	int n = (jobList != NULL) ? 0 : atof(argv[1]);
+	// # of integration points, exact as an integer or in floating point notation such as 1e12
+	char *end;
+	long int N = strtol(argv[argc - 1], &end, 10);
+	if (*end != '\0')
+		N = (long int)atof(argv[argc - 1]);
 
 	// Arrays
 	double *a = (double *) malloc(n*sizeof(double));
@@ -34,18 +44,135 @@ int main(int argc, char *argv[])
 		b[i] = atof(argv[i + n + 2]);
 	}
 
-	// Initialize MPI
-	MPI_Init(&argc, &argv);
+	// options go between the b's (or the job list) and N
+	int scalar = 0;
+	int generic = 0;
+	Integrand *integrand = integrandOf(&fcn);
+	for (int i = (jobList != NULL) ? 3 : 2*n + 2; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc - 1)
+			mcOptions.seed = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-scalar") == 0)
+			scalar = 1;
+		else if (strcmp(argv[i], "-generic") == 0)
+			generic = 1;
+		else if (strcmp(argv[i], "-integrand") == 0 && i + 1 < argc - 1)
+		{
+			i++;
+			if (findIntegrand(argv[i]) != NULL)
+				integrand = findIntegrand(argv[i]);
+			else
+				printf("Unknown integrand %s, using fcn\n", argv[i]);
+		}
+		else if (strcmp(argv[i], "-qmc") == 0)
+			mcOptions.mode = MC_QMC;
+		else if (strcmp(argv[i], "-vegas") == 0)
+			mcOptions.mode = MC_VEGAS;
+		else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc - 1)
+			mcOptions.iterations = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-stratify") == 0)
+			mcOptions.stratify = 1;
+		else if (strcmp(argv[i], "-abstol") == 0 && i + 1 < argc - 1)
+			mcOptions.absTol = atof(argv[++i]);
+		else if (strcmp(argv[i], "-reltol") == 0 && i + 1 < argc - 1)
+			mcOptions.relTol = atof(argv[++i]);
+		else if (strcmp(argv[i], "-time") == 0 && i + 1 < argc - 1)
+			mcOptions.timeBudget = atof(argv[++i]);
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc - 1)
+			mcOptions.threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-progress") == 0 && i + 1 < argc - 1)
+			mcOptions.progress = atof(argv[++i]);
+		else if (strcmp(argv[i], "-dynamic") == 0)
+			mcOptions.dynamic = 1;
+		else if (strcmp(argv[i], "-every") == 0 && i + 1 < argc - 1)
+			mcOptions.every = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-replicates") == 0 && i + 1 < argc - 1)
+			mcOptions.replicates = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-scramble") == 0 && i + 1 < argc - 1)
+		{
+			i++;
+			if (strcmp(argv[i], "none") == 0)
+				mcOptions.scramble = QMC_NONE;
+			else if (strcmp(argv[i], "shift") == 0)
+				mcOptions.scramble = QMC_SHIFT;
+			else if (strcmp(argv[i], "owen") == 0)
+				mcOptions.scramble = QMC_OWEN;
+			else
+				printf("Unknown scrambling %s, using shift\n", argv[i]);
+		}
+		else
+			printf("Ignoring unknown option %s\n", argv[i]);
+	}
+
+	if (mcOptions.replicates < 1)
+		mcOptions.replicates = 1;
+	if (mcOptions.iterations < 1)
+		mcOptions.iterations = 1;
+	if (mcOptions.every < 1)
+		mcOptions.every = 1;
+
+	// use the block version of the integrand if it has one
+	if (!scalar)
+		mcOptions.batch = integrand->batch;
+
+	// and its sampling kernel for this dimension, unless -generic asks for the loops over the dimensions
+	if (!scalar && !generic && integrand->kernel != NULL)
+		mcOptions.sample = integrand->kernel(n);
+
+	if (mcOptions.threads > 0)
+		omp_set_num_threads(mcOptions.threads);
+
+	// Initialize MPI, only the main thread makes MPI calls
+	int provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 	// Get process rank
 	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
 	// Get # of processes
 	MPI_Comm_size(MPI_COMM_WORLD, &p);
 
-	integral = parallelMonteCarlo(a, b, n, N, &fcn, my_rank, p, MPI_COMM_WORLD);
+	if (jobList != NULL)
+	{
+		IntegralJob *jobs;
+		int count = readJobs(jobList, &jobs);
+		if (count < 0)
+			MPI_Abort(MPI_COMM_WORLD, 1);
+
+		double start = MPI_Wtime();
+		batchMonteCarlo(jobs, count, N, scalar, my_rank, p, MPI_COMM_WORLD);
+		double seconds = MPI_Wtime() - start;
+
+		if (my_rank == 0)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				IntegralJob *job = jobs + i;
+				double reference = job->integrand->exact(job->a, job->b, job->n);
+				printf("Job %d: %s in %d dimensions, value %.10e, standard error %.3e, absolute error %.3e\n",
+					i + 1, job->integrand->name, job->n, job->estimate, job->error, fabs(job->estimate - reference));
+			}
+			printf("%d jobs of %ld samples in %.3f s\n", count, N, seconds);
+		}
+
+		freeJobs(jobs, count);
+		MPI_Finalize();
+		free(a);
+		free(b);
+		return 0;
+	}
+
+	integral = parallelMonteCarlo(a, b, n, N, integrand->fcn, my_rank, p, MPI_COMM_WORLD);
 	if (my_rank == 0)
 	{
-		checkResult(integral, a, b, n, N, &fcn);
+		double error = checkResult(integral, a, b, n, N, integrand->fcn);
 		printf("Value of the integral is %.4e\n", integral);
+		if (error >= 0)
+			printf("Reference %.10e, absolute error %.3e\n", integrand->exact(a, b, n), error);
+		if (mcResult.error >= 0)
+			printf("Standard error %.4e over %ld samples\n", mcResult.error, mcResult.samples);
+		if (mcResult.seconds > 0)
+			printf("%ld samples in %.3f s, %.3e samples/s\n", mcResult.samples, mcResult.seconds, mcResult.samples / mcResult.seconds);
+		if (mcResult.chi2dof >= 0)
+			printf("chi^2/dof %.3f\n", mcResult.chi2dof);
 	}
 
 	// free arrays and exit MPI
@@ -5,30 +5,96 @@
 // a is a pointer to n doubles, where a[i] stores a_i+1
 // b is a pointer to n doubles, where a[i] stores b_i+1
 // n is dimension n
+// first is the global index of the first of the N samples
 // N is # of random points to be used in the integration
 // fcn is a pointer to function returning double with arguments (double *, int)
+// batch is the block version of fcn, or NULL to call fcn once per point
+// sample is the sampling kernel of fcn for dimension n, used instead of batch; NULL for none
+// seed is the random generator seed
+// Sample s always takes its coordinates from stream s/MC_CHUNK, so the points do not depend on
+// how the samples are split between processes. Points are generated and evaluated in blocks of
+// up to MC_CHUNK, stored dimension by dimension (see BatchFcn).
 
 #include <stdlib.h>
 #include <stdio.h>
-#define drand48() ((rand()/(double)(RAND_MAX)))
+#include "monte-carlo.h"
 
-double MonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n))
+// Adapter that evaluates a block with a point by point integrand
+void scalarBatch(double (*fcn)(double *x, int n), double *x, int n, int count, double *f)
 {
-	double sum = 0;
-	double *x = (double*)malloc(n*sizeof(double));
-	
-	// Iterate N times and add function value to sum
-	for (int i = 0; i < N; i++)
+	double *point = (double*)malloc(n*sizeof(double));
+
+	for (int i = 0; i < count; i++)
 	{
 		for (int j = 0; j < n; j++)
+			point[j] = x[(long int)j*count + i];
+		f[i] = fcn(point, n);
+	}
+
+	free(point);
+}
+
+// Points of the box [a, b] from count points of uniforms, u[k*n + j] being coordinate j of point k;
+// x receives them dimension by dimension (see BatchFcn)
+void mapPoints(const double *u, const double *a, const double *b, int n, int count, double *x)
+{
+	for (int j = 0; j < n; j++)
+	{
+		double *xj = x + (long int)j*count;
+		double aj = a[j], width = b[j] - a[j];
+#pragma omp simd
+		for (int k = 0; k < count; k++)
+			xj[k] = aj + u[(long int)k*n + j] * width;
+	}
+}
+
+// squares, unless NULL, receives the sum of f^2 over the samples
+double MonteCarlo(double *a, double *b, int n, long int first, long int N, double (*fcn)(double *x, int n), BatchFcn batch, SampleFcn sample, unsigned long int seed, double *squares)
+{
+	double sum = 0, c = 0, sum2 = 0, c2 = 0;
+	double *u = (double*)malloc(MC_CHUNK*n*sizeof(double));
+	double *x = (double*)malloc(MC_CHUNK*n*sizeof(double));
+	double *f = (double*)malloc(MC_CHUNK*sizeof(double));
+	long int i = 0;
+
+	// Work through the samples one stream piece at a time
+	while (i < N)
+	{
+		long int s = first + i;
+		long int offset = s % MC_CHUNK;
+		int count = MC_CHUNK - offset;
+		if (count > N - i)
+			count = N - i;
+
+		// all uniforms for this piece at once, point by point
+		rngUniform(u, (long int)count*n, seed, s / MC_CHUNK, offset*n);
+
+		// the kernel maps and evaluates in one pass, otherwise random values between a and b,
+		// dimension by dimension, then call function for integration
+		if (sample != NULL)
+			sample(u, a, b, n, count, f);
+		else
 		{
-			// random value between a and b, append to x
-			x[j] = a[j] + drand48() * (b[j] - a[j]);
+			mapPoints(u, a, b, n, count, x);
+			if (batch != NULL)
+				batch(x, n, count, f);
+			else
+				scalarBatch(fcn, x, n, count, f);
 		}
-		//call function for integration
-		sum+=fcn(x, n);
+
+		// compensated, billions of samples would lose digits in a plain sum
+		for (int k = 0; k < count; k++)
+			neumaierAdd(&sum, &c, f[k]);
+		if (squares != NULL)
+			for (int k = 0; k < count; k++)
+				neumaierAdd(&sum2, &c2, f[k] * f[k]);
+		i += count;
 	}
 
+	free(u);
 	free(x);
-	return sum;
-}
\ No newline at end of file
+	free(f);
+	if (squares != NULL)
+		*squares = sum2 + c2;
+	return sum + c;
+}
@@ -0,0 +1,152 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// monte-carlo.h
+// Settings and helpers shared by the integrator files.
+
+#ifndef MONTE_CARLO_H
+#define MONTE_CARLO_H
+
+#include <stdint.h>
+#include "mpi.h"
+
+// samples per random stream; sample s uses stream s/MC_CHUNK
+#define MC_CHUNK 1024
+
+// most blocks the samples of the static split are summed in
+#define MC_MAXBLOCKS 65536
+
+// dimensions with their own unrolled sampling kernels; larger ones use the loops
+#define MC_KERNELS 16
+
+// default seed when -seed is not given
+#define MC_SEED 20140606
+
+// sampling modes
+#define MC_RANDOM 0
+#define MC_QMC 1
+#define MC_VEGAS 2
+
+// quasi-Monte Carlo scrambling
+#define QMC_NONE 0
+#define QMC_SHIFT 1
+#define QMC_OWEN 2
+
+// most dimensions of the Sobol sequence
+#define QMC_MAXDIM 1024
+
+// random streams from QMC_STREAM on scramble the replicates; sample streams stay far below
+#define QMC_STREAM (1UL << 62)
+
+// integrand evaluated on a block of count points stored dimension by dimension:
+// x[j*count + i] is coordinate j of point i, f[i] receives its value
+typedef void (*BatchFcn)(double *x, int n, int count, double *f);
+
+// integrand evaluated straight from the uniforms of count points, u[k*n + j] being coordinate j
+// of point k, mapped into the box [a, b]; f[k] receives its value
+typedef void (*SampleFcn)(const double *u, const double *a, const double *b, int n, int count, double *f);
+
+// integrand with a known mean over any box (see integrands.c)
+typedef struct
+{
+	const char *name;
+	double (*fcn)(double *x, int n);			// point by point
+	BatchFcn batch;						// block version, NULL if none
+	SampleFcn (*kernel)(int n);				// sampling kernel unrolled for dimension n, NULL if none
+	double (*exact)(double *a, double *b, int n);		// mean over [a, b]
+} Integrand;
+
+extern Integrand mcIntegrands[];
+
+// one integral of a batch (see batch-monte-carlo.c)
+typedef struct
+{
+	Integrand *integrand;
+	int n;					// dimension
+	double *a, *b;				// box
+	double estimate;			// mean of the integrand over the box, on process 0
+	double error;				// its standard error, on process 0
+} IntegralJob;
+
+// options set by main before parallelMonteCarlo is called
+typedef struct
+{
+	unsigned long int seed;		// generator seed (-seed)
+	BatchFcn batch;			// block version of the integrand; NULL calls fcn point by point (-scalar)
+	SampleFcn sample;		// sampling kernel of the dimension used instead of batch; NULL for none (-generic)
+	int mode;			// MC_RANDOM, or MC_QMC (-qmc)
+	int replicates;			// independently scrambled QMC replicates (-replicates)
+	int scramble;			// QMC_NONE, QMC_SHIFT or QMC_OWEN (-scramble)
+	int iterations;			// VEGAS grid iterations (-iterations)
+	int stratify;			// stratify VEGAS samples in hypercubes (-stratify)
+	double absTol;			// stop at this standard error (-abstol); 0 for none
+	double relTol;			// stop at this standard error relative to the estimate (-reltol); 0 for none
+	double timeBudget;		// stop after this many seconds (-time); 0 for none
+	int every;			// batches between two reductions of the adaptive mode (-every)
+	int dynamic;			// hand the blocks of the static split out on demand (-dynamic)
+	int threads;			// OpenMP threads per process (-threads); 0 for the OpenMP default
+	double progress;		// seconds between progress reports of the static split (-progress); 0 for none
+	int verbose;			// print details of the sampling on process 0
+} MonteCarloOptions;
+
+// extra results of the last integration, valid on process 0
+typedef struct
+{
+	double error;			// standard error of the estimate; negative if unknown
+	long int samples;		// integrand evaluations used
+	double chi2dof;			// chi^2 per degree of freedom of the VEGAS iterations; negative if none
+	double seconds;			// time of the integration; negative if not measured
+} MonteCarloResult;
+
+// add x to the sum kept as sum + c (Neumaier); the error stays independent of the number of terms
+static inline void neumaierAdd(double *sum, double *c, double x)
+{
+	double t = *sum + x;
+	if ((*sum >= 0 ? *sum : -*sum) >= (x >= 0 ? x : -x))
+		*c += (*sum - t) + x;
+	else
+		*c += (x - t) + *sum;
+	*sum = t;
+}
+
+// the part of count items taken by process my_rank of p, the first count%p processes take one more
+#define SHARE(count, my_rank, p) ((count)/(p) + ((my_rank) < (count)%(p)))
+#define SHARE_FIRST(count, my_rank, p) ((my_rank)*((count)/(p)) + ((my_rank) < (count)%(p) ? (my_rank) : (count)%(p)))
+
+extern MonteCarloOptions mcOptions;
+extern MonteCarloResult mcResult;
+
+void fcnBatch(double *x, int n, int count, double *f);
+
+SampleFcn fcnKernel(int n);
+
+void mapPoints(const double *u, const double *a, const double *b, int n, int count, double *x);
+
+void scalarBatch(double (*fcn)(double *x, int n), double *x, int n, int count, double *f);
+
+int sobolInit(int n);
+
+void sobolPoints(double *x, int n, unsigned long int first, int count, const uint64_t *shift, const uint32_t *owen);
+
+double parallelQuasiMonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com);
+
+Integrand *findIntegrand(const char *name);
+
+Integrand *integrandOf(double (*f)(double *x, int n));
+
+double pairwiseSum(const double *x, long int count);
+
+double adaptiveMonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com);
+
+double dynamicMonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com);
+
+double parallelVegas(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com);
+
+int readJobs(const char *path, IntegralJob **jobs);
+
+void freeJobs(IntegralJob *jobs, int count);
+
+void batchMonteCarlo(IntegralJob *jobs, int count, long int N, int scalar, int my_rank, int p, MPI_Comm com);
+
+void rngUniform(double *u, long int count, unsigned long int seed, unsigned long int stream, unsigned long int first);
+
+#endif
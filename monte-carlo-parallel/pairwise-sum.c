@@ -0,0 +1,18 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// pairwise-sum.c
+
+// returns the sum of the count values of x
+// The halves are added recursively, so the rounding error grows with log(count) instead of
+// count, and the order of the additions only depends on count.
+
+double pairwiseSum(const double *x, long int count)
+{
+	if (count <= 0)
+		return 0;
+	if (count == 1)
+		return x[0];
+
+	long int half = count / 2;
+	return pairwiseSum(x, half) + pairwiseSum(x + half, count - half);
+}
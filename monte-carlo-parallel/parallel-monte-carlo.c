@@ -2,7 +2,7 @@
 
 // parallel-monte-carlo.c
 
-// returns approximation for monte-carlo on process 0
+// returns approximation for monte-carlo on process 0, 0 on the others
 // a is a pointer to n doubles, where a[i] stores a_i+1
 // b is a pointer to n doubles, where a[i] stores b_i+1
 // n is dimension n
@@ -11,47 +11,125 @@
 // my_rank is rank of process where this function is called
 // p is # of processes
 // com is a communicator for MPI
+// The samples are cut in blocks of whole MC_CHUNK chunks that depend only on N. Processes take
+// contiguous ranges of blocks and their OpenMP threads sum one block at a time, each in sample
+// order. Process 0 gathers the block sums and adds them with a fixed pairwise tree, so the result
+// is the same to the bit for any number of processes and threads; the block sums of f^2 give the
+// standard error in mcResult.error. The seed, the block integrand and its sampling kernel come
+// from mcOptions. N may be larger than 2^31; every mcOptions.progress seconds process 0 reports
+// how far it is.
+// With mcOptions.mode MC_QMC the points come from parallelQuasiMonteCarlo instead, with MC_VEGAS
+// from parallelVegas. With a tolerance or a time budget, adaptiveMonteCarlo samples until it is met
+// and N is only the most samples to use. With mcOptions.dynamic the same blocks are handed out on
+// demand by dynamicMonteCarlo, for integrands of uneven cost; the result is the same.
 
 #include "mpi.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "monte-carlo.h"
 
-extern double MonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n));
+extern double MonteCarlo(double *a, double *b, int n, long int first, long int N, double (*fcn)(double *x, int n), BatchFcn batch, SampleFcn sample, unsigned long int seed, double *squares);
+
+// options for all integrations, set by main
+MonteCarloOptions mcOptions = { .seed = MC_SEED, .batch = NULL, .sample = NULL, .mode = MC_RANDOM, .replicates = 8, .scramble = QMC_SHIFT, .iterations = 10, .stratify = 0,
+	.absTol = 0, .relTol = 0, .timeBudget = 0, .every = 16, .dynamic = 0,
+	.threads = 0, .progress = 10, .verbose = 1 };
+MonteCarloResult mcResult = { .error = -1, .samples = 0, .chi2dof = -1, .seconds = -1 };
 
 double parallelMonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com)
 {
-	// integration summations
-	double sum;
-	double totalSum;
+	// integration summations, of f and of f^2
+	double *sums, *squares;
+	double *allSums = NULL, *allSquares = NULL;
+	double totalSum = 0;
 
 	// required variables for MPI
-	int source;
-	int dest = 0;
-	int tag = 0;
-	MPI_Status status;
-
-	// If process != 0, perform monte carlo integration on N/p points
-	// then send result to process 0
-	if (my_rank > 0)
+	int *counts = NULL;
+	int *displs = NULL;
+
+	if (mcOptions.mode == MC_QMC)
+		return parallelQuasiMonteCarlo(a, b, n, N, fcn, my_rank, p, com);
+	if (mcOptions.mode == MC_VEGAS)
+		return parallelVegas(a, b, n, N, fcn, my_rank, p, com);
+	if (mcOptions.absTol > 0 || mcOptions.relTol > 0 || mcOptions.timeBudget > 0)
+		return adaptiveMonteCarlo(a, b, n, N, fcn, my_rank, p, com);
+	if (mcOptions.dynamic)
+		return dynamicMonteCarlo(a, b, n, N, fcn, my_rank, p, com);
+
+	// The samples form at most MC_MAXBLOCKS blocks of whole chunks; the block size only depends on N
+	long int chunks = (N + MC_CHUNK - 1) / MC_CHUNK;
+	long int perBlock = (chunks + MC_MAXBLOCKS - 1) / MC_MAXBLOCKS;
+	long int blockSamples = perBlock * MC_CHUNK;
+	int blocks = (chunks + perBlock - 1) / perBlock;
+
+	// Blocks are spread evenly over the processes, each process takes a contiguous range
+	int myBlocks = SHARE(blocks, my_rank, p);
+	int firstBlock = SHARE_FIRST(blocks, my_rank, p);
+	sums = (double*)malloc((myBlocks > 0 ? myBlocks : 1)*sizeof(double));
+	squares = (double*)malloc((myBlocks > 0 ? myBlocks : 1)*sizeof(double));
+
+	// each block is summed by one thread, in sample order
+	int done = 0;
+	double start = omp_get_wtime(), lastReport = start;
+#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < myBlocks; k++)
 	{
-		sum = MonteCarlo(a, b, n, (N/p), fcn);
-		MPI_Send(&sum, 1, MPI_DOUBLE, dest, tag, com);
-		// return sum;
+		long int first = (firstBlock + k) * blockSamples;
+		long int count = (N - first < blockSamples) ? N - first : blockSamples;
+		sums[k] = MonteCarlo(a, b, n, first, count, fcn, mcOptions.batch, mcOptions.sample, mcOptions.seed, squares + k);
+
+		// process 0 reports its progress, the others have the same share of the work
+		if (my_rank == 0 && mcOptions.progress > 0)
+		{
+#pragma omp critical
+			{
+				double now = omp_get_wtime();
+				done++;
+				if (now - lastReport >= mcOptions.progress && done < myBlocks)
+				{
+					printf("Progress: %.1f%% after %.0f s, about %.0f s left\n", 100.0 * done / myBlocks, now - start, (now - start) * (myBlocks - done) / done);
+					fflush(stdout);
+					lastReport = now;
+				}
+			}
+		}
 	}
 
-	// if process = 0, perform monte carlo integration on (N/P + N%p) points
-	// then get results from other processes, add them as well
-	else
+	// process 0 collects the block sums in block order
+	if (my_rank == 0)
 	{
-		totalSum = MonteCarlo(a, b, n, (N/p + N%p), fcn);
-		//get results from other procs, add
-		for(source = 1; source < p; source++)
+		allSums = (double*)malloc(blocks*sizeof(double));
+		allSquares = (double*)malloc(blocks*sizeof(double));
+		counts = (int*)malloc(p*sizeof(int));
+		displs = (int*)malloc(p*sizeof(int));
+		for (int source = 0; source < p; source++)
 		{
-			MPI_Recv(&sum, 1, MPI_DOUBLE, source, tag, com, &status);
-			totalSum += sum;
+			counts[source] = SHARE(blocks, source, p);
+			displs[source] = SHARE_FIRST(blocks, source, p);
 		}
+	}
+	MPI_Gatherv(sums, myBlocks, MPI_DOUBLE, allSums, counts, displs, MPI_DOUBLE, 0, com);
+	MPI_Gatherv(squares, myBlocks, MPI_DOUBLE, allSquares, counts, displs, MPI_DOUBLE, 0, com);
+
+	if (my_rank == 0)
+	{
+		// same tree for any number of processes and threads, so the same bits
+		totalSum = pairwiseSum(allSums, blocks);
 
 		// Divide value by N to get avg result
 		totalSum = totalSum/N;
-		return totalSum;
+		double variance = pairwiseSum(allSquares, blocks) / N - totalSum * totalSum;
+		mcResult.error = (N > 1) ? sqrt((variance > 0 ? variance : 0) / (N - 1)) : -1;
+		mcResult.samples = N;
 	}
-}
\ No newline at end of file
+
+	free(sums);
+	free(squares);
+	free(allSums);
+	free(allSquares);
+	free(counts);
+	free(displs);
+	return totalSum;
+}
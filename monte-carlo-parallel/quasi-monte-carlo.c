@@ -0,0 +1,117 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// quasi-monte-carlo.c
+
+// Quasi-Monte Carlo integration with scrambled Sobol points.
+// The N points are split into mcOptions.replicates independent replicates, each an
+// independently scrambled Sobol sequence of about N/replicates points. Every process takes a
+// contiguous part of every replicate and skips straight to it. The estimate is the mean of the
+// replicate means, and their spread gives the standard error in mcResult.error. Unscrambled
+// replicates would all be the same points, so without scrambling there is one replicate and no
+// standard error.
+// a, b, n, N, fcn, my_rank, p and com are as for parallelMonteCarlo.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "mpi.h"
+#include "monte-carlo.h"
+
+// sum of fcn over points first .. first + N - 1 of replicate r
+double QuasiMonteCarlo(double *a, double *b, int n, long int first, long int N, double (*fcn)(double *x, int n), BatchFcn batch, int r)
+{
+	double sum = 0, c = 0;
+	double *x = (double*)malloc(MC_CHUNK*n*sizeof(double));
+	double *f = (double*)malloc(MC_CHUNK*sizeof(double));
+	double *u = (double*)malloc(2*n*sizeof(double));
+	uint64_t *shift = (uint64_t*)malloc(n*sizeof(uint64_t));
+	uint32_t *owen = (uint32_t*)malloc(n*sizeof(uint32_t));
+
+	// scramble of this replicate, from its own random stream
+	rngUniform(u, 2*n, mcOptions.seed, QMC_STREAM + r, 0);
+	for (int j = 0; j < n; j++)
+	{
+		shift[j] = (uint64_t)(u[2*j] * 0x1p53) << 11;
+		owen[j] = (uint32_t)(u[2*j + 1] * 0x1p32);
+	}
+
+	for (long int i = 0; i < N; i += MC_CHUNK)
+	{
+		int count = (N - i < MC_CHUNK) ? N - i : MC_CHUNK;
+
+		sobolPoints(x, n, first + i, count, (mcOptions.scramble == QMC_NONE) ? NULL : shift, (mcOptions.scramble == QMC_OWEN) ? owen : NULL);
+
+		// map the unit cube onto [a, b]
+		for (int j = 0; j < n; j++)
+		{
+			double *xj = x + (long int)j*count;
+			double aj = a[j], width = b[j] - a[j];
+#pragma omp simd
+			for (int k = 0; k < count; k++)
+				xj[k] = aj + xj[k] * width;
+		}
+
+		if (batch != NULL)
+			batch(x, n, count, f);
+		else
+			scalarBatch(fcn, x, n, count, f);
+
+		for (int k = 0; k < count; k++)
+			neumaierAdd(&sum, &c, f[k]);
+	}
+
+	free(x);
+	free(f);
+	free(u);
+	free(shift);
+	free(owen);
+	return sum + c;
+}
+
+double parallelQuasiMonteCarlo(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com)
+{
+	int R = (mcOptions.scramble == QMC_NONE) ? 1 : mcOptions.replicates;
+	double *sums = (double*)malloc(R*sizeof(double));
+	double *totals = (double*)malloc(R*sizeof(double));
+	double estimate = 0, variance = 0;
+
+	if (!sobolInit(n))
+	{
+		if (my_rank == 0)
+			printf("Quasi-Monte Carlo supports at most %d dimensions\n", QMC_MAXDIM);
+		MPI_Abort(com, 1);
+	}
+	if (my_rank == 0 && R < mcOptions.replicates)
+		printf("Unscrambled Sobol points take one replicate, ignoring -replicates %d\n", mcOptions.replicates);
+
+	// replicate r has Nr points, spread evenly over the processes
+	for (int r = 0; r < R; r++)
+	{
+		long int Nr = SHARE(N, r, R);
+		long int first = SHARE_FIRST(Nr, my_rank, p);
+		long int count = SHARE(Nr, my_rank, p);
+		sums[r] = QuasiMonteCarlo(a, b, n, first, count, fcn, mcOptions.batch, r);
+	}
+
+	MPI_Reduce(sums, totals, R, MPI_DOUBLE, MPI_SUM, 0, com);
+
+	if (my_rank == 0)
+	{
+		for (int r = 0; r < R; r++)
+		{
+			totals[r] /= SHARE(N, r, R);
+			estimate += totals[r];
+		}
+		estimate /= R;
+
+		for (int r = 0; r < R; r++)
+			variance += (totals[r] - estimate) * (totals[r] - estimate);
+		mcResult.error = (R > 1) ? sqrt(variance / (R - 1) / R) : -1;
+		mcResult.samples = N;
+	}
+
+	free(sums);
+	free(totals);
+	return estimate;
+}
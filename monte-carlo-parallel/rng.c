@@ -0,0 +1,80 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// rng.c
+
+// Counter-based random numbers (Philox4x32-10).
+// A random value is a pure function of (seed, stream, index): the key is the seed and the
+// counter holds the stream and the index, so any part of any stream can be generated directly
+// without stepping through the numbers before it and without shared generator state.
+// Streams are identified by global sample chunk (see MC_CHUNK), not by rank or thread, so the
+// same sample gets the same point whichever process or thread draws it.
+
+#include <stdint.h>
+#include "monte-carlo.h"
+
+// Philox4x32 constants
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// counters generated together, each gives 2 doubles
+#define RNG_LANES 8
+
+// u is a pointer to count doubles to fill with uniforms in (0, 1)
+// seed selects the generator, stream the independent sequence within it
+// first is the index of u[0] within the stream
+void rngUniform(double *u, long int count, unsigned long int seed, unsigned long int stream, unsigned long int first)
+{
+	uint64_t block = first / 2;
+	int skip = first % 2;
+	long int done = 0;
+	double out[2 * RNG_LANES];
+
+	while (done < count)
+	{
+		// generate RNG_LANES blocks side by side, the lanes are independent so each step vectorizes
+		uint32_t c0[RNG_LANES], c1[RNG_LANES], c2[RNG_LANES], c3[RNG_LANES];
+		uint32_t k0 = (uint32_t)seed;
+		uint32_t k1 = (uint32_t)((uint64_t)seed >> 32);
+
+#pragma omp simd
+		for (int l = 0; l < RNG_LANES; l++)
+		{
+			c0[l] = (uint32_t)(block + l);
+			c1[l] = (uint32_t)((block + l) >> 32);
+			c2[l] = (uint32_t)stream;
+			c3[l] = (uint32_t)((uint64_t)stream >> 32);
+		}
+
+		for (int r = 0; r < 10; r++)
+		{
+#pragma omp simd
+			for (int l = 0; l < RNG_LANES; l++)
+			{
+				uint64_t p0 = (uint64_t)PHILOX_M0 * c0[l];
+				uint64_t p1 = (uint64_t)PHILOX_M1 * c2[l];
+				c0[l] = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+				c2[l] = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+				c1[l] = (uint32_t)p1;
+				c3[l] = (uint32_t)p0;
+			}
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+
+		// 53 random bits per double, offset by half a step so 0 and 1 never occur
+#pragma omp simd
+		for (int l = 0; l < RNG_LANES; l++)
+		{
+			out[2 * l] = ((double)((((uint64_t)c0[l] << 32) | c1[l]) >> 11) + 0.5) * 0x1p-53;
+			out[2 * l + 1] = ((double)((((uint64_t)c2[l] << 32) | c3[l]) >> 11) + 0.5) * 0x1p-53;
+		}
+
+		for (int i = skip; i < 2 * RNG_LANES && done < count; i++)
+			u[done++] = out[i];
+
+		block += RNG_LANES;
+		skip = 0;
+	}
+}
@@ -0,0 +1,154 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// sobol.c
+
+// Scrambled Sobol points for quasi-Monte Carlo.
+// Dimension 1 is the van der Corput sequence, dimension j > 1 uses the (j-1)-th primitive
+// polynomial over GF(2), in order of degree then value, as Bratley and Fox number them. The
+// primitive polynomials are found at start up instead of being tabulated, and the initial
+// direction numbers m_k (odd, below 2^k) are drawn from a fixed random stream, which keeps the
+// (t,s)-sequence property of every dimension.
+// Points are taken in Gray code order, so any point can be computed directly from its index
+// and the next one with a single XOR per dimension; a process can start anywhere.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "monte-carlo.h"
+
+// bits of every coordinate
+#define SOBOL_BITS 63
+
+// random stream of the initial direction numbers; fixed so every run uses the same sequence
+#define SOBOL_DIRSEED 0x50B01
+
+static uint64_t (*direction)[SOBOL_BITS] = NULL;
+static int sobolDims = 0;
+
+// is the polynomial p of degree s primitive, that is does x have order 2^s - 1 modulo p
+static int primitive(unsigned int p, int s)
+{
+	unsigned int period = (1u << s) - 1;
+	unsigned int r = 1;
+
+	for (unsigned int count = 1; count <= period; count++)
+	{
+		r <<= 1;
+		if (r & (1u << s))
+			r ^= p;
+		if (r == 1)
+			return count == period;
+	}
+	return 0;
+}
+
+// Build the direction numbers of the first n dimensions
+// returns 0 when n is larger than QMC_MAXDIM
+int sobolInit(int n)
+{
+	if (n <= sobolDims)
+		return 1;
+	if (n > QMC_MAXDIM)
+		return 0;
+
+	free(direction);
+	direction = malloc(n * sizeof(*direction));
+	sobolDims = n;
+
+	// van der Corput: m_k = 1
+	for (int k = 1; k <= SOBOL_BITS; k++)
+		direction[0][k - 1] = (uint64_t)1 << (SOBOL_BITS - k);
+
+	int j = 1;
+	double u[SOBOL_BITS];
+	for (int s = 1; j < n; s++)
+	{
+		for (unsigned int p = (1u << s) | 1; p < (2u << s) && j < n; p += 2)
+		{
+			if (!primitive(p, s))
+				continue;
+
+			uint64_t *v = direction[j];
+
+			// initial direction numbers, odd m_k < 2^k
+			rngUniform(u, s, SOBOL_DIRSEED, j, 0);
+			for (int k = 1; k <= s; k++)
+			{
+				uint64_t m = 2 * (uint64_t)(u[k - 1] * (1u << (k - 1))) + 1;
+				v[k - 1] = m << (SOBOL_BITS - k);
+			}
+
+			// v_k = v_{k-s} ^ (v_{k-s} >> s) ^ sum of a_i v_{k-i} for the inner coefficients a_i
+			for (int k = s + 1; k <= SOBOL_BITS; k++)
+			{
+				uint64_t next = v[k - s - 1] ^ (v[k - s - 1] >> s);
+				for (int i = 1; i < s; i++)
+					if ((p >> (s - i)) & 1)
+						next ^= v[k - i - 1];
+				v[k - 1] = next;
+			}
+			j++;
+		}
+	}
+
+	return 1;
+}
+
+// Owen scrambling of a 32-bit fraction by hashing (Laine-Karras permutation on reversed bits)
+static uint32_t reverseBits(uint32_t x)
+{
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+	x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+static uint32_t owenScramble(uint32_t x, uint32_t seed)
+{
+	x = reverseBits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return reverseBits(x);
+}
+
+// x receives count points stored dimension by dimension (see BatchFcn), starting with point
+// first of the sequence.
+// shift holds a random digital shift per dimension, NULL for none. owen holds a seed per
+// dimension to Owen scramble the top 32 bits with, NULL for none; the shift then only applies to
+// the bits below.
+void sobolPoints(double *x, int n, unsigned long int first, int count, const uint64_t *shift, const uint32_t *owen)
+{
+	uint64_t gray = first ^ (first >> 1);
+
+	for (int j = 0; j < n; j++)
+	{
+		const uint64_t *v = direction[j];
+		double *xj = x + (long int)j*count;
+		uint64_t state = 0;
+
+		// point first directly from the bits of its Gray code
+		for (int k = 0; k < SOBOL_BITS; k++)
+			if ((gray >> k) & 1)
+				state ^= v[k];
+
+		for (int i = 0; i < count; i++)
+		{
+			uint64_t y = state;
+			if (shift != NULL)
+				y ^= shift[j] >> 1;
+			if (owen != NULL)
+				y = ((uint64_t)owenScramble((uint32_t)(state >> 31), owen[j]) << 31) | (y & 0x7FFFFFFFu);
+
+			// top 53 bits, offset by half a step so 0 is never returned
+			xj[i] = ((double)(y >> 10) + 0.5) * 0x1p-53;
+
+			// next point in Gray code order flips the direction number of the lowest zero bit
+			unsigned long int index = first + i;
+			state ^= v[__builtin_ctzl(~index)];
+		}
+	}
+}
@@ -0,0 +1,249 @@
+// Aimal Khan SE4F03 Assignment 1
+
+// vegas.c
+
+// Adaptive importance sampling (VEGAS) with optional stratification.
+// Each dimension of the unit cube has a grid of VEGAS_BINS bins of equal probability; a point y
+// of the cube falls in bin i and is mapped linearly into it, so narrow bins sample densely. After
+// every iteration the bins are resized so each holds the same share of the sum of (f*J)^2, which
+// concentrates points where the integrand is large. With -stratify, y itself is stratified: the
+// cube is cut in ns^n equal hypercubes with the same number of points in each.
+// The N points are spread over mcOptions.iterations iterations. Every iteration is split between
+// the processes by sample index and one MPI_Allreduce merges the per hypercube moments and the
+// grid weights, so every process refines the grid the same way. The iteration estimates are
+// combined weighted by their inverse variance; mcResult gets the standard error and chi^2/dof.
+// a, b, n, N, fcn, my_rank, p and com are as for parallelMonteCarlo.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "mpi.h"
+#include "monte-carlo.h"
+
+// bins per dimension
+#define VEGAS_BINS 50
+
+// grid damping exponent
+#define VEGAS_ALPHA 1.5
+
+// most hypercubes when stratifying
+#define VEGAS_MAXCUBES 4096
+
+// random streams of iteration i start at VEGAS_STREAM + i*VEGAS_STREAMSTEP
+#define VEGAS_STREAM (1UL << 61)
+#define VEGAS_STREAMSTEP (1UL << 40)
+
+// Resize the bins of one dimension so each gets an equal share of the weights d
+static void refineGrid(double *edges, double *d)
+{
+	double smooth[VEGAS_BINS], weight[VEGAS_BINS];
+	double newEdges[VEGAS_BINS + 1];
+	double total = 0, sumWeight = 0;
+	int i;
+
+	// average with the neighbours, then normalize
+	for (i = 0; i < VEGAS_BINS; i++)
+	{
+		if (i == 0)
+			smooth[i] = (d[0] + d[1]) / 2;
+		else if (i == VEGAS_BINS - 1)
+			smooth[i] = (d[i - 1] + d[i]) / 2;
+		else
+			smooth[i] = (d[i - 1] + d[i] + d[i + 1]) / 3;
+		total += smooth[i];
+	}
+	if (total <= 0)
+		return;
+
+	// damped weights, so the grid does not change too fast
+	for (i = 0; i < VEGAS_BINS; i++)
+	{
+		double r = smooth[i] / total;
+		weight[i] = (r > 0 && r < 1) ? pow((r - 1) / log(r), VEGAS_ALPHA) : 0;
+		sumWeight += weight[i];
+	}
+	if (sumWeight <= 0)
+		return;
+
+	// new edges split the weight into equal parts, linearly within the old bins
+	double step = sumWeight / VEGAS_BINS;
+	double acc = 0;
+	int old = 0;
+	newEdges[0] = 0;
+	for (i = 1; i < VEGAS_BINS; i++)
+	{
+		double target = i * step;
+		while (old < VEGAS_BINS - 1 && acc + weight[old] < target)
+			acc += weight[old++];
+		double frac = (weight[old] > 0) ? (target - acc) / weight[old] : 0;
+		newEdges[i] = edges[old] + frac * (edges[old + 1] - edges[old]);
+	}
+	newEdges[VEGAS_BINS] = 1;
+	memcpy(edges, newEdges, sizeof(newEdges));
+}
+
+double parallelVegas(double *a, double *b, int n, long int N, double (*fcn)(double *x, int n), int my_rank, int p, MPI_Comm com)
+{
+	int iterations = mcOptions.iterations;
+	long int perIteration = N / iterations;
+
+	// ns^n hypercubes of perCube points each
+	int ns = 1;
+	long int cubes = 1;
+	if (mcOptions.stratify)
+	{
+		ns = (int)floor(pow(perIteration / 2.0, 1.0 / n));
+		while (ns > 1 && pow(ns, n) > VEGAS_MAXCUBES)
+			ns--;
+		if (ns < 1)
+			ns = 1;
+		cubes = (long int)pow(ns, n);
+	}
+	long int perCube = perIteration / cubes;
+	long int used = perCube * cubes;
+	if (perCube < 2)
+	{
+		if (my_rank == 0)
+			printf("VEGAS needs at least 2 points per hypercube and iteration\n");
+		MPI_Abort(com, 1);
+	}
+
+	// grid of every dimension, equal bins to start with
+	double *edges = (double*)malloc(n*(VEGAS_BINS + 1)*sizeof(double));
+	for (int j = 0; j < n; j++)
+		for (int i = 0; i <= VEGAS_BINS; i++)
+			edges[j*(VEGAS_BINS + 1) + i] = (double)i / VEGAS_BINS;
+
+	// moments of every hypercube and grid weights, merged in one reduction
+	long int size = 2*cubes + (long int)n*VEGAS_BINS;
+	double *local = (double*)malloc(size*sizeof(double));
+	double *global = (double*)malloc(size*sizeof(double));
+
+	double *u = (double*)malloc(MC_CHUNK*n*sizeof(double));
+	double *x = (double*)malloc(MC_CHUNK*n*sizeof(double));
+	double *f = (double*)malloc(MC_CHUNK*sizeof(double));
+	double *jac = (double*)malloc(MC_CHUNK*sizeof(double));
+	int *bin = (int*)malloc(MC_CHUNK*n*sizeof(int));
+
+	// my part of every iteration
+	long int first = SHARE_FIRST(used, my_rank, p);
+	long int count = SHARE(used, my_rank, p);
+
+	double sumInvVar = 0, sumWeighted = 0, sumSquares = 0;
+	double *estimates = (double*)malloc(iterations*sizeof(double));
+	double *variances = (double*)malloc(iterations*sizeof(double));
+
+	for (int it = 0; it < iterations; it++)
+	{
+		memset(local, 0, size*sizeof(double));
+		double *moments = local;
+		double *d = local + 2*cubes;
+
+		for (long int i = 0; i < count; )
+		{
+			long int s = first + i;
+			long int offset = s % MC_CHUNK;
+			int block = MC_CHUNK - offset;
+			if (block > count - i)
+				block = count - i;
+
+			rngUniform(u, (long int)block*n, mcOptions.seed, VEGAS_STREAM + it*VEGAS_STREAMSTEP + s/MC_CHUNK, offset*n);
+
+			for (int k = 0; k < block; k++)
+				jac[k] = 1;
+
+			for (int j = 0; j < n; j++)
+			{
+				double *e = edges + j*(VEGAS_BINS + 1);
+				double *xj = x + (long int)j*block;
+				int *bj = bin + (long int)j*block;
+				long int stride = (long int)pow(ns, j);
+
+				for (int k = 0; k < block; k++)
+				{
+					// stratified y, then through the grid
+					long int h = (s + k) / perCube;
+					double y = (((h / stride) % ns) + u[(long int)k*n + j]) / ns;
+					double pos = y * VEGAS_BINS;
+					int ib = (int)pos;
+					if (ib >= VEGAS_BINS)
+						ib = VEGAS_BINS - 1;
+					double width = e[ib + 1] - e[ib];
+					double unit = e[ib] + (pos - ib) * width;
+
+					xj[k] = a[j] + unit * (b[j] - a[j]);
+					jac[k] *= VEGAS_BINS * width;
+					bj[k] = ib;
+				}
+			}
+
+			if (mcOptions.batch != NULL)
+				mcOptions.batch(x, n, block, f);
+			else
+				scalarBatch(fcn, x, n, block, f);
+
+			for (int k = 0; k < block; k++)
+			{
+				double w = f[k] * jac[k];
+				long int h = (s + k) / perCube;
+				moments[2*h] += w;
+				moments[2*h + 1] += w * w;
+				for (int j = 0; j < n; j++)
+					d[j*VEGAS_BINS + bin[(long int)j*block + k]] += w * w;
+			}
+
+			i += block;
+		}
+
+		MPI_Allreduce(local, global, size, MPI_DOUBLE, MPI_SUM, com);
+
+		// estimate and variance of this iteration from the hypercubes
+		double estimate = 0, variance = 0;
+		for (long int h = 0; h < cubes; h++)
+		{
+			double mean = global[2*h] / perCube;
+			double var = (global[2*h + 1] - perCube * mean * mean) / (perCube - 1);
+			estimate += mean;
+			variance += (var > 0 ? var : 0) / perCube;
+		}
+		estimate /= cubes;
+		variance /= (double)cubes * cubes;
+
+		// keep a tiny floor so an exact iteration does not divide by zero
+		if (variance <= 0)
+			variance = 1e-300;
+		estimates[it] = estimate;
+		variances[it] = variance;
+		sumInvVar += 1 / variance;
+		sumWeighted += estimate / variance;
+
+		for (int j = 0; j < n; j++)
+			refineGrid(edges + j*(VEGAS_BINS + 1), global + 2*cubes + j*VEGAS_BINS);
+	}
+
+	double result = sumWeighted / sumInvVar;
+	for (int it = 0; it < iterations; it++)
+		sumSquares += (estimates[it] - result) * (estimates[it] - result) / variances[it];
+
+	if (my_rank == 0)
+	{
+		mcResult.error = sqrt(1 / sumInvVar);
+		mcResult.chi2dof = (iterations > 1) ? sumSquares / (iterations - 1) : -1;
+		mcResult.samples = used * iterations;
+		if (mcOptions.verbose)
+			printf("VEGAS: %d iterations of %ld points, %ld hypercubes\n", iterations, used, cubes);
+	}
+
+	free(edges);
+	free(local);
+	free(global);
+	free(u);
+	free(x);
+	free(f);
+	free(jac);
+	free(bin);
+	free(estimates);
+	free(variances);
+	return result;
+}
@@ -0,0 +1,221 @@
+// SE4F03 Final Project
+// Aimal Khan
+// Sean McLellan
+
+// divisors.c
+
+// Divisor engine: counts M(N) without enumerating the products.
+// A value k <= n^2 is in the table iff it has a divisor d with k/n <= d <= n (then k = d * (k/d)
+// with both factors at most n). The values 1 .. n^2 are taken in segments; a segmented sieve
+// with the primes up to n factors every value of a segment, and a search over its divisors that
+// stay at most n decides membership. A value with a prime factor above n is never in the table,
+// and a value up to n always is.
+// Segment s goes to rank s % p, the threads of a rank share its segments.
+// Products of a divisor and a value reach n^3, so n must stay below DIVISOR_LIMIT (2^21).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "multtable.h"
+
+//Values per segment, at least; a segment holds the factors of all its values
+#define DIVISOR_SEGMENT (1LL << 12)
+
+//Most distinct primes of a value below 2^63
+#define MAX_FACTORS 16
+
+//Primes up to limit with a sieve of Eratosthenes, count receives how many
+static uint32_t *primesUpTo(long long int limit, long long int *count)
+{
+	char *composite = (char*)calloc(limit + 1, 1);
+	uint32_t *primes;
+	long long int i, j, found = 0;
+
+	for (i = 2; i <= limit; i++)
+		if (!composite[i])
+		{
+			found++;
+			for (j = i * i; j <= limit; j += i)
+				composite[j] = 1;
+		}
+
+	primes = (uint32_t*)malloc((found > 0 ? found : 1) * sizeof(uint32_t));
+	found = 0;
+	for (i = 2; i <= limit; i++)
+		if (!composite[i])
+			primes[found++] = (uint32_t)i;
+
+	free(composite);
+	*count = found;
+	return primes;
+}
+
+//Is there a divisor of the value, made of d times powers of factors first .. factors - 1,
+//that is at least low and at most n. d itself is a divisor at most n, rest[i] is the product
+//of the prime powers i .. factors - 1.
+static bool findDivisor(const uint32_t *prime, const uint8_t *exponent, const long long int *rest, int first, int factors, long long int d, long long int low, long long int n)
+{
+	int e;
+
+	if (d >= low)
+		return true;
+	if (first == factors || d * rest[first] < low)
+		return false;
+
+	//Highest power that keeps d at most n first, it gets to low soonest
+	long long int q = prime[first];
+	long long int power = 1;
+	for (e = 0; e < exponent[first] && d * power <= n / q; e++)
+		power *= q;
+	for (; e >= 0; e--, power /= q)
+		if (findDivisor(prime, exponent, rest, first + 1, factors, d * power, low, n))
+			return true;
+	return false;
+}
+
+//Number of values in [lo, hi) that are in the n x n table
+//smooth, prime, exponent and factors are buffers for the values of the segment
+static long long int countSegment(long long int lo, long long int hi, long long int n, const uint32_t *primes, long long int primeCount,
+	long long int *smooth, uint32_t *prime, uint8_t *exponent, int *factors)
+{
+	long long int size = hi - lo;
+	long long int count = 0;
+	long long int i, k;
+
+	for (i = 0; i < size; i++)
+	{
+		smooth[i] = 1;
+		factors[i] = 0;
+	}
+
+	//Primes up to sqrt(hi - 1) are enough, what is left after them is 1 or a prime
+	long long int top = 0, bottom = primeCount;
+	while (top < bottom)
+	{
+		long long int middle = (top + bottom) / 2;
+		if ((long long int)primes[middle] * primes[middle] <= hi - 1)
+			top = middle + 1;
+		else
+			bottom = middle;
+	}
+
+	//Sieve them largest first, so the search starts with them. The multiples of q start a factor,
+	//those of every higher power of q raise its exponent; smooth collects the product of the
+	//prime powers found, so no value is divided during the sieve.
+	for (k = top - 1; k >= 0; k--)
+	{
+		long long int q = primes[k];
+		long long int power;
+
+		for (i = ((lo + q - 1) / q) * q - lo; i < size; i += q)
+		{
+			prime[i * MAX_FACTORS + factors[i]] = (uint32_t)q;
+			exponent[i * MAX_FACTORS + factors[i]] = 1;
+			factors[i]++;
+			smooth[i] *= q;
+		}
+
+		for (power = q * q; power <= hi - 1; power *= q)
+		{
+			for (i = ((lo + power - 1) / power) * power - lo; i < size; i += power)
+			{
+				exponent[i * MAX_FACTORS + factors[i] - 1]++;
+				smooth[i] *= q;
+			}
+			if (power > (hi - 1) / q)
+				break;
+		}
+	}
+
+	for (i = 0; i < size; i++)
+	{
+		long long int value = lo + i;
+
+		if (value <= n)
+		{
+			count++;
+			continue;
+		}
+
+		//What is left after the small primes is 1 or a prime; a prime above n can not be in any
+		//factor, which is known without dividing
+		if (smooth[i] * n < value)
+			continue;
+		long long int left = (smooth[i] == value) ? 1 : value / smooth[i];
+
+		//The leftover prime goes first as the largest
+		uint32_t valuePrimes[MAX_FACTORS + 1];
+		uint8_t valueExponents[MAX_FACTORS + 1];
+		int f = 0, j;
+		if (left > 1)
+		{
+			valuePrimes[f] = (uint32_t)left;
+			valueExponents[f++] = 1;
+		}
+		for (j = 0; j < factors[i]; j++)
+		{
+			valuePrimes[f] = prime[i * MAX_FACTORS + j];
+			valueExponents[f++] = exponent[i * MAX_FACTORS + j];
+		}
+
+		long long int rest[MAX_FACTORS + 2];
+		rest[f] = 1;
+		for (j = f - 1; j >= 0; j--)
+		{
+			rest[j] = rest[j + 1];
+			for (int e = 0; e < valueExponents[j]; e++)
+				rest[j] *= valuePrimes[j];
+		}
+
+		if (findDivisor(valuePrimes, valueExponents, rest, 0, f, 1, (value + n - 1) / n, n))
+			count++;
+	}
+
+	return count;
+}
+
+//Returns the number of distinct products in the segments of this rank
+long long int divisorCount(long long int n, int my_rank, int p)
+{
+	long long int primeCount, uniqueCount = 0, segmentsDone = 0, valuesDone = 0;
+	uint32_t *primes = primesUpTo(n, &primeCount);
+	long long int last = n * n;
+
+	//Small segments stay in cache, but every segment pays once for each prime up to n, so large
+	//tables take about n values per segment
+	long long int size = (n > DIVISOR_SEGMENT) ? n : DIVISOR_SEGMENT;
+	if (size > 256 * DIVISOR_SEGMENT)
+		size = 256 * DIVISOR_SEGMENT;
+	long long int segments = (last + size - 1) / size;
+
+#pragma omp parallel reduction(+:uniqueCount, segmentsDone, valuesDone)
+	{
+		long long int *smooth = (long long int*)malloc(size * sizeof(long long int));
+		uint32_t *prime = (uint32_t*)malloc(size * MAX_FACTORS * sizeof(uint32_t));
+		uint8_t *exponent = (uint8_t*)malloc(size * MAX_FACTORS * sizeof(uint8_t));
+		int *factors = (int*)malloc(size * sizeof(int));
+		long long int s;
+
+#pragma omp for schedule(dynamic)
+		for (s = my_rank; s < segments; s += p)
+		{
+			long long int lo = s * size + 1;
+			long long int hi = (lo + size <= last + 1) ? lo + size : last + 1;
+			uniqueCount += countSegment(lo, hi, n, primes, primeCount, smooth, prime, exponent, factors);
+			segmentsDone++;
+			valuesDone += hi - lo;
+		}
+
+		free(smooth);
+		free(prime);
+		free(exponent);
+		free(factors);
+	}
+
+	mtWork.segments += segmentsDone;
+	mtWork.products += valuesDone;
+
+	free(primes);
+	return uniqueCount;
+}
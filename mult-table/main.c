@@ -10,152 +10,330 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
 #include <time.h>
+#include <omp.h>
+#include <unistd.h>
 #include "mpi.h"
+#include "multtable.h"
+#ifdef __AVX512VPOPCNTDQ__
+#include <immintrin.h>
+#endif
 
+//Options, set by rank 0 from the command line and broadcast
+TableOptions mtOptions = { .engine = ENGINE_ENUMERATE, .check = false, .dynamic = false, .report = false, .threads = 0, .segment = 0, .shared = false, .sequence = false, .csv = false };
 
+//With mtOptions.sequence, products of this rank by the smallest table they appear in
+long long int *mtHistogram = NULL;
 
-int main (int argc, char *argv[])
+//Work of this rank in the last count
+TableWork mtWork = { .segments = 0, .rows = 0, .products = 0 };
+
+//Number of set bits in words 64-bit words
+long long int countBits(const uint64_t *bits, long long int words)
 {
-	//MPI Initialization
-	int p, my_rank;
-	MPI_Status status;
-	MPI_Init(NULL, NULL);
-	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-	MPI_Comm_size(MPI_COMM_WORLD, &p);
+	long long int count = 0;
+	long long int w = 0;
 
-	//Dimension of table
-	long long int n;
+#ifdef __AVX512VPOPCNTDQ__
+	//Eight words at a time with VPOPCNTQ
+	__m512i sums = _mm512_setzero_si512();
+	for (; w + 8 <= words; w += 8)
+		sums = _mm512_add_epi64(sums, _mm512_popcnt_epi64(_mm512_loadu_si512(bits + w)));
+	count = _mm512_reduce_add_epi64(sums);
+#endif
+
+	for (; w < words; w++)
+		count += __builtin_popcountll(bits[w]);
+
+	return count;
+}
+
+//Mark in bits every product row * col with firstRow <= row <= lastRow, row <= col <= n
+//that lies in the segment (min, max]. Bit (product - min - 1) stands for product.
+//Rows of other threads may share words, atomic makes every mark an atomic OR.
+//Returns the number of products marked.
+long long int markRows(uint64_t *bits, long long int firstRow, long long int lastRow, long long int n, long long int min, long long int max, bool atomic)
+{
+	long long int row, marked = 0;
+
+	for (row = firstRow; row <= lastRow; row++)
+	{
+		//Exact columns of this row in the segment: ceil((min + 1) / row) <= col <= max / row
+		long long int lo = (min + row) / row;
+		long long int hi = max / row;
+		if (lo < row)
+			lo = row;
+		if (hi > n)
+			hi = n;
+
+		//Columns start at row, so once row * row is past the segment every later row is too
+		if (lo > hi && row * row > max)
+			break;
+
+		//Products of the row are an arithmetic progression with step row
+		long long int offset = row * lo - min - 1;
+		long long int count = hi - lo + 1;
+		long long int k;
+		if (atomic)
+			for (k = 0; k < count; k++, offset += row)
+				__atomic_fetch_or(bits + (offset >> 6), (uint64_t)1 << (offset & 63), __ATOMIC_RELAXED);
+		else
+			for (k = 0; k < count; k++, offset += row)
+				bits[offset >> 6] |= (uint64_t)1 << (offset & 63);
+		marked += count;
+	}
+
+	return marked;
+}
+
+//Like markRows, but for every product of the segment sizes receives the smallest table it
+//appears in: sizes[product - min - 1] = col for the largest row, which has the smallest col.
+//Rows go up, so alone the last store is the one that stays; with atomic, other threads mark
+//other rows and a size only replaces a larger one.
+//Returns the number of products marked.
+long long int markSizes(uint32_t *sizes, long long int firstRow, long long int lastRow, long long int n, long long int min, long long int max, bool atomic)
+{
+	long long int row, marked = 0;
+
+	for (row = firstRow; row <= lastRow; row++)
+	{
+		long long int lo = (min + row) / row;
+		long long int hi = max / row;
+		if (lo < row)
+			lo = row;
+		if (hi > n)
+			hi = n;
+
+		if (lo > hi && row * row > max)
+			break;
+
+		long long int offset = row * lo - min - 1;
+		long long int col;
+		if (atomic)
+			for (col = lo; col <= hi; col++, offset += row)
+			{
+				uint32_t size = __atomic_load_n(sizes + offset, __ATOMIC_RELAXED);
+				while ((size == 0 || size > col) &&
+					!__atomic_compare_exchange_n(sizes + offset, &size, (uint32_t)col, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+					;
+			}
+		else
+			for (col = lo; col <= hi; col++, offset += row)
+				sizes[offset] = (uint32_t)col;
+		if (hi >= lo)
+			marked += hi - lo + 1;
+	}
+
+	return marked;
+}
+
+//Bytes of memory of this node we may use: the physical memory, or the cgroup limit if lower
+long long int nodeMemory(void)
+{
+	long long int memory = (long long int)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+	const char *limits[] = { "/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory/memory.limit_in_bytes" };
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		FILE *file = fopen(limits[i], "r");
+		long long int limit;
+		if (file == NULL)
+			continue;
+		//cgroup v2 writes "max" for no limit, v1 a huge number
+		if (fscanf(file, "%lld", &limit) == 1 && limit > 0 && limit < memory)
+			memory = limit;
+		fclose(file);
+	}
+
+	return memory;
+}
+
+//Bytes of the L2 cache, which sizes the segments
+long long int cacheBytes(void)
+{
+	long long int bytes = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+	return (bytes > 0) ? bytes : DEFAULT_CACHE;
+}
+
+//Products per segment of one rank, one bit each, the same on every rank: mtOptions.segment if
+//set, otherwise 1/CACHE_SHARE of the L2 cache, as every row walked marks across the whole
+//segment and a segment out of cache costs a miss per mark. SEGMENT_SHARE of the memory of a node
+//split between its ranksPerNode ranks, less a buffer per rank, caps it.
+long long int segmentProducts(int my_rank, int ranksPerNode)
+{
+	long long int products, smallest;
+
+	long long int memory = nodeMemory();
+	long long int fit = (memory / SEGMENT_SHARE / ranksPerNode - BUFFER * 1024 * 1024) * 8;
+	products = cacheBytes() / CACHE_SHARE * 8;
+	if (products > fit)
+		products = fit;
+	if (mtOptions.segment > 0)
+		products = mtOptions.segment;
+
+	//Nodes may differ, every rank needs the same segments
+	MPI_Allreduce(&products, &smallest, 1, MPI_LONG_LONG_INT, MPI_MIN, MPI_COMM_WORLD);
+
+	if (mtOptions.report && my_rank == 0)
+		printf("Segments of %lld products (%.1f MB) per rank, %.1f MB of L2 cache, %d ranks per node, %.0f MB of memory per node\n",
+			smallest, smallest / 8.0 / 1024 / 1024, cacheBytes() / 1024.0 / 1024, ranksPerNode, memory / 1024.0 / 1024);
+
+	return smallest;
+}
+
+//Make the stores of every rank of the group to the shared bitmap visible to all of them
+void syncBitmap(MPI_Win bitmap, MPI_Comm group)
+{
+	MPI_Win_sync(bitmap);
+	MPI_Barrier(group);
+	MPI_Win_sync(bitmap);
+}
+
+//Enumeration engine: marks the products of the table segment by segment.
+//Segment j covers the values (startRow * n, endRow * n] of rows startRow .. endRow - 1 of the
+//table. Segments go round robin to the groups of ranks that share a bitmap, or with
+//mtOptions.dynamic each group claims the next free one from a counter in a window of rank 0 as
+//soon as it is done with the last, so the low segments, which hold the most products, do not
+//hold up the groups that got them.
+//A group is one rank, or with mtOptions.shared all ranks of a node: they allocate one bitmap,
+//ranks on the node times larger, with MPI_Win_allocate_shared. The ranks split the row blocks
+//of a node segment and mark them into it together, so each row is walked once per node segment
+//instead of once per rank segment; MPI_Win_sync and a barrier on the node (syncBitmap) separate
+//clearing, marking and counting, which the ranks also split.
+//Every row with products in a segment is walked once for it: the OpenMP threads take blocks of
+//ROW_BLOCK rows and mark them across the whole segment, with atomic ORs if there are several
+//threads, as rows share words. Segments fill part of the L2 cache, so the marks stay in cache
+//(see segmentProducts). Clearing the bitmap before and counting its bits after are split in
+//pieces of whole words, at least THREAD_PIECES per thread, which the ranks of the group take in
+//turn and their threads share.
+//With mtOptions.sequence every product gets the smallest table it appears in instead of a bit,
+//32 bits each, and mtHistogram[k] counts the products of this rank that first appear in the
+//k x k table.
+//Returns the number of distinct products in the pieces of this rank.
+long long int enumerateCount(long long int n, int my_rank, int p)
+{
 	//Processor specific unique count
 	long long int uniqueCount = 0;
-	//Total unique count
-	long long int totalUniqueCount = 0;
-	int row,col,i;
-	//Determines whether final row of segment has been reached
-	bool bEndOfSegment = false;
-	
-	/* SET THESE BEFORE COMPILE */
-	int ranks_per_node = p; //if only 1 node, just number of cores
 
-	//Memory use in MB
-	long long int MEMORY = 2 * 1024; //Memory per node
-	long long int BUFFER = 20; //Amount of memory to afford buffer per rank (in MB)
+	//Ranks of this node
+	MPI_Comm node;
+	int ranksPerNode, nodeRank;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, my_rank, MPI_INFO_NULL, &node);
+	MPI_Comm_size(node, &ranksPerNode);
+	MPI_Comm_rank(node, &nodeRank);
 
-	//Retrieve parameters
-	if (my_rank == 0)
+	//Groups sharing a bitmap: the nodes, numbered by their first rank, or every rank alone
+	MPI_Comm group = MPI_COMM_SELF;
+	int groupSize = 1, groupRank = 0, groups = p, groupIndex = my_rank;
+	if (mtOptions.shared)
 	{
-		if (argc == 2)
+		MPI_Comm leaders;
+		group = node;
+		groupSize = ranksPerNode;
+		groupRank = nodeRank;
+		MPI_Comm_split(MPI_COMM_WORLD, (nodeRank == 0) ? 0 : MPI_UNDEFINED, my_rank, &leaders);
+		if (nodeRank == 0)
 		{
-			if (argv[1] != NULL)
-			{
-				n = atol(argv[1]);
-			}
+			MPI_Comm_size(leaders, &groups);
+			MPI_Comm_rank(leaders, &groupIndex);
+			MPI_Comm_free(&leaders);
 		}
+		MPI_Bcast(&groups, 1, MPI_INT, 0, node);
+		MPI_Bcast(&groupIndex, 1, MPI_INT, 0, node);
 	}
 
-	//Broadcast n to all processors
-	MPI_Bcast(&n, 1, MPI_LONG_LONG_INT, 0, MPI_COMM_WORLD);
+	//Bytes for 64 products: a word of bits, or 64 table sizes
+	long long int wordBytes = mtOptions.sequence ? 64 * sizeof(uint32_t) : sizeof(uint64_t);
 
-	//Only adjust if you know how much memory your cores will have available to them.
-	//If this is set to a value, MEMORY and BUFFER are ignored.
-	long long int MAX_SIZE = 26000000;
+	//Nodes may hold different numbers of ranks, but segment j must cover the same rows for every
+	//group, so segments are sized for the smallest group
+	int smallestGroup;
+	MPI_Allreduce(&groupSize, &smallestGroup, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
 
-	//(((MEMORY * 1024 * 1024)/ranks_per_node) - (n * 2 * sizeof(long long int)) - BUFFER * 1024 * 1024)/(sizeof(long long int));
-	
-	//printf("MAX ARRAY SIZE: %lld\n", MAX_SIZE);
+	//Products per segment from the cache and memory of the node, or -segment, for the whole group
+	//Larger segments walk the rows fewer times, but only while they stay in cache
+	long long int MAX_SIZE = segmentProducts(my_rank, ranksPerNode) * smallestGroup / (wordBytes / sizeof(uint64_t));
 
 	//The limit on memory must be at least as large as n
-	//Increasing MAX_SIZE increases memory usage, but increases performance
-	//This adjustment may cause unexpected behaviour. Set the memory before compile.
 	if (MAX_SIZE < n)
 		MAX_SIZE = n;
 	
-	long long int *segments;
-	segments = (long long int*)malloc(2 * n * sizeof(long long int));
-	memset (segments, 0, 2 * n * sizeof(long long int));
-	
-	//Distribute workload evenly across processors
-	//Each processor calculates own segment
-	int processorsUsed = p;
-	if (n < p)
-		processorsUsed = n;
+	//Distribute workload evenly across groups
+	//Each group calculates own segment
+	int groupsUsed = groups;
+	if (n < groups)
+		groupsUsed = n;
 
 	//Set MAX_SIZE
 	if (MAX_SIZE > (n * n))
 	{
-		MAX_SIZE = (n * n) / processorsUsed + (n * n) % processorsUsed;
+		MAX_SIZE = (n * n) / groupsUsed + (n * n) % groupsUsed;
 	}
-	
-	//The row that the last segment ends on, this checks termination
-	long long int prevRowEnd = 0;
-	//Total elements given to segment
-	long long int totalElements = 0;
-	int processor;
-	
-	long long int r = 0;
-	long long int iteration = 0;
-	long long int highestIteration = 0;
-	
-	while (prevRowEnd < n)
-	{
-		//printf("%lld\n", prevRowEnd);
-		for (processor = 0; processor < processorsUsed; processor++)
-		{
-			//Reset each iteration
-			totalElements = 0;
-			//Set initial start row for segment, this is the min
-			if (my_rank == processor)
-			{
-				segments[iteration] = prevRowEnd;
-				//printf("rank: %d, start:%lld\n", my_rank, segments[iteration]);
-			}
-			
-			for (r = prevRowEnd; r < n; r++)
-			{
-				//The step is the size of the n value
-				if (totalElements + n <= MAX_SIZE)
-				{
-					totalElements += n;
-				}
-				else
-				{
-					//If the total number of elements stored in segment is too large to add another row
-					//break the loop, set the prevEndRow to r.
-					break;
-				}
-			}
 
-			prevRowEnd = r;
-			if (my_rank == processor)
-			{
-				//This is the max
-				segments[iteration + 1] = prevRowEnd;
-				//printf("rank: %d, end:%lld\n", my_rank, segments[iteration + 1]);
-				//Track the highest iteration for this processor
-				highestIteration = iteration + 1;
-			}
-		}
-		//Increase the iteration by 2, each iteration stores a min and max
-		iteration+=2;
-	}
+	int threads = omp_get_max_threads();
 
-	//CPU Time
-	double time;
-	clock_t start, end;
-	start = clock();
+	//Every segment takes as many whole rows of n products as fit
+	long long int rowsPerSegment = MAX_SIZE / n;
+
+	//Claimed segments only balance the load if there are several per group
+	if (mtOptions.dynamic && rowsPerSegment > (n + DYNAMIC_SEGMENTS * groups - 1) / (DYNAMIC_SEGMENTS * groups))
+		rowsPerSegment = (n + DYNAMIC_SEGMENTS * groups - 1) / (DYNAMIC_SEGMENTS * groups);
+	long long int segments = (n + rowsPerSegment - 1) / rowsPerSegment;
 
-	//Iterate through all segments previously defined above unique to each processor.
-	for (i = 0; i <= highestIteration; i+=2)
+	//Tracking the appearance of all products in the segment, one bit per product (or their table
+	//sizes), reused for every segment; in the shared window the first rank of the node holds all
+	char *productBits;
+	long long int bitmapWords = (rowsPerSegment * n + 63) / 64;
+	MPI_Win bitmap;
+	if (mtOptions.shared)
 	{
-		//Tracking the appearance of all products in the segment
-		long long int *productCount;
+		MPI_Aint size;
+		int unit;
+		MPI_Win_allocate_shared((groupRank == 0) ? bitmapWords * wordBytes : 0, 1, MPI_INFO_NULL, group, &productBits, &bitmap);
+		MPI_Win_shared_query(bitmap, 0, &size, &unit, &productBits);
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, bitmap);
+	}
+	else
+		productBits = (char*)malloc(bitmapWords * wordBytes);
+
+	//Products by smallest table size, one histogram per thread
+	long long int *histograms = NULL;
+	if (mtOptions.sequence)
+		histograms = (long long int*)calloc((long long int)threads * (n + 1), sizeof(long long int));
 
-		//Reset after each segment
-		bEndOfSegment = false;
+	//Next free segment, in the window of rank 0
+	long long int *counter;
+	long long int one = 1;
+	long long int j;
+	MPI_Win win;
+	if (mtOptions.dynamic)
+	{
+		MPI_Win_allocate((my_rank == 0) ? sizeof(long long int) : 0, sizeof(long long int), MPI_INFO_NULL, MPI_COMM_WORLD, &counter, &win);
+		if (my_rank == 0)
+			*counter = 0;
+		MPI_Barrier(MPI_COMM_WORLD);
+		MPI_Win_lock_all(0, win);
+		if (groupRank == 0)
+		{
+			MPI_Fetch_and_op(&one, &j, MPI_LONG_LONG_INT, 0, 0, MPI_SUM, win);
+			MPI_Win_flush(0, win);
+		}
+		MPI_Bcast(&j, 1, MPI_LONG_LONG_INT, 0, group);
+	}
+	else
+		j = (groupIndex < groupsUsed) ? groupIndex : segments;
 
+	while (j < segments)
+	{
 		long long int startRow, endRow;
-		startRow = segments[i];
-		endRow = segments[i+1];
+		startRow = j * rowsPerSegment;
+		endRow = (startRow + rowsPerSegment < n) ? startRow + rowsPerSegment : n;
 		
 		long long int max;
 		long long int min;
@@ -166,49 +344,272 @@ int main (int argc, char *argv[])
 		long long int range;
 		range = max - min;
 
-		//Buffer for segment is at most of size n for each segment
-		productCount = (long long int*)malloc(range * sizeof(long long int));
-		memset (productCount, 0, range * sizeof(long long int));
+		//Bit for product is at (product - min - 1), rounded up to whole words
+		long long int words = (range + 63) / 64;
+
+		//Pieces of pieceWords words, about the L2 cache each and several per thread of the
+		//group as low pieces hold more products
+		long long int pieces = (words * wordBytes + cacheBytes() - 1) / cacheBytes();
+		if (threads * groupSize > 1 && pieces < THREAD_PIECES * threads * groupSize)
+			pieces = THREAD_PIECES * threads * groupSize;
+		long long int pieceWords = (words + pieces - 1) / pieces;
+		long long int marked = 0, found = 0, walked = 0;
+		long long int q;
+
+#pragma omp parallel for schedule(dynamic)
+		for (q = groupRank; q < pieces; q += groupSize)
+		{
+			long long int lowWord = q * pieceWords;
+			long long int highWord = (lowWord + pieceWords < words) ? lowWord + pieceWords : words;
+			if (lowWord < highWord)
+				memset(productBits + lowWord * wordBytes, 0, (highWord - lowWord) * wordBytes);
+		}
+		if (mtOptions.shared)
+			syncBitmap(bitmap, group);
+
+		//Rows with products in the segment: rows up to startRow only reach min, and columns
+		//start at the row, so rows with row * row > max have none
+		long long int firstRow = startRow + 1;
+		long long int lastRow = (long long int)sqrt((double)max);
+		while (lastRow * lastRow > max)
+			lastRow--;
+		while ((lastRow + 1) * (lastRow + 1) <= max)
+			lastRow++;
+		if (lastRow > n)
+			lastRow = n;
+		long long int rowBlocks = (lastRow - firstRow + ROW_BLOCK) / ROW_BLOCK;
+		bool atomic = threads * groupSize > 1;
+		long long int b;
+
+#pragma omp parallel for schedule(dynamic) reduction(+:marked, walked)
+		for (b = groupRank; b < rowBlocks; b += groupSize)
+		{
+			long long int low = firstRow + b * ROW_BLOCK;
+			long long int high = (low + ROW_BLOCK - 1 < lastRow) ? low + ROW_BLOCK - 1 : lastRow;
+			walked += high - low + 1;
+			if (mtOptions.sequence)
+				marked += markSizes((uint32_t*)productBits, low, high, n, min, max, atomic);
+			else
+				marked += markRows((uint64_t*)productBits, low, high, n, min, max, atomic);
+		}
+		if (mtOptions.shared)
+			syncBitmap(bitmap, group);
 
-		for (row = startRow + 1; row <= n; row++)
+#pragma omp parallel for schedule(dynamic) reduction(+:found)
+		for (q = groupRank; q < pieces; q += groupSize)
 		{
-			for (col = row; col <= n; col++)
+			long long int lowBit = q * pieceWords * 64;
+			long long int highBit = (lowBit + pieceWords * 64 < range) ? lowBit + pieceWords * 64 : range;
+			if (lowBit >= highBit)
+				continue;
+
+			if (mtOptions.sequence)
 			{
-				long long int product = row * col;
-				//printf("ROW:%lld COL:%lld P:%lld MAX:%lld\n", row, col, product, max);
-
-				if (product > min && product <= max)
-				{
-					//Gives each value in segment a unique value based on max value
-					//of segment for tracking count
-					if (productCount[max - product] <= 0)
+				uint32_t *pieceSizes = (uint32_t*)productBits + lowBit;
+				long long int *histogram = histograms + (long long int)omp_get_thread_num() * (n + 1);
+				long long int v;
+
+				//Every distinct product of the piece has a size, count it there
+				for (v = 0; v < highBit - lowBit; v++)
+					if (pieceSizes[v] != 0)
 					{
-						//printf("%lld, %lld, %lld\n", product, min, max);
-						uniqueCount++;
-						productCount[max - product]++;
+						histogram[pieceSizes[v]]++;
+						found++;
 					}
-				}
-		
-				if (product > max)
-				{
-					//printf("%lld, %lld, %lld\n", row, col, max);
-					if (row == col)
-						bEndOfSegment = true;
-					break;
-				}
 			}
+			else
+			{
+				//Every distinct product of the piece is one set bit
+				found += countBits((uint64_t*)productBits + q * pieceWords, (highBit - lowBit + 63) / 64);
+			}
+		}
+		if (mtOptions.shared)
+			syncBitmap(bitmap, group);
+
+		mtWork.rows += walked;
+		mtWork.products += marked;
+		mtWork.segments++;
+		uniqueCount += found;
 
-			if (bEndOfSegment)
-				break;
+		//Next segment of this group, once all its ranks are done with the bitmap
+		if (mtOptions.dynamic)
+		{
+			if (groupRank == 0)
+			{
+				MPI_Fetch_and_op(&one, &j, MPI_LONG_LONG_INT, 0, 0, MPI_SUM, win);
+				MPI_Win_flush(0, win);
+			}
+			MPI_Bcast(&j, 1, MPI_LONG_LONG_INT, 0, group);
 		}
+		else
+			j += groupsUsed;
+	}
+
+	if (mtOptions.dynamic)
+	{
+		MPI_Win_unlock_all(win);
+		MPI_Win_free(&win);
+	}
 
-		//Release memory
-		free (productCount);
+	if (mtOptions.sequence)
+	{
+		long long int t, k;
+		for (t = 0; t < threads; t++)
+			for (k = 0; k <= n; k++)
+				mtHistogram[k] += histograms[t * (n + 1) + k];
+		free(histograms);
 	}
 
+	if (mtOptions.shared)
+	{
+		MPI_Win_unlock_all(bitmap);
+		MPI_Win_free(&bitmap);
+	}
+	else
+		free(productBits);
+	MPI_Comm_free(&node);
+
+	return uniqueCount;
+}
+
+//Write M(k) for k = 1 .. n from the products counted by smallest table: text lines "k,M(k)" for
+//mtOptions.csv, otherwise n native long long ints
+//Returns false if the file can not be written.
+bool writeSequence(const char *path, const long long int *histogram, long long int n)
+{
+	FILE *file = fopen(path, (mtOptions.csv) ? "w" : "wb");
+	long long int k, count = 0;
+
+	if (file == NULL)
+	{
+		printf("Cannot open sequence file %s\n", path);
+		return false;
+	}
+
+	if (mtOptions.csv)
+		fprintf(file, "N,M(N)\n");
+	for (k = 1; k <= n; k++)
+	{
+		count += histogram[k];
+		if (mtOptions.csv)
+			fprintf(file, "%lld,%lld\n", k, count);
+		else
+			fwrite(&count, sizeof(long long int), 1, file);
+	}
+
+	return fclose(file) == 0;
+}
+
+int main (int argc, char *argv[])
+{
+	//MPI Initialization, only the main thread makes MPI calls
+	int p, my_rank, provided;
+	MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &provided);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+	//Dimension of table
+	long long int n;
+	//Processor specific unique count
+	long long int uniqueCount = 0;
+	//Total unique count
+	long long int totalUniqueCount = 0;
+	//File of the whole sequence, on rank 0
+	const char *sequencePath = NULL;
+	int i;
+
+	//Retrieve parameters: multtable [-engine enumerate|divisor] [-check] [-dynamic] [-shared] [-report] [-threads t] [-segment s]
+	//	[-sequence file [-format binary|csv]] n
+	//-check runs both engines and compares them, -dynamic hands out the segments on demand,
+	//-shared makes the ranks of a node share one bitmap, -report prints the work and time of
+	//every rank, -threads sets the OpenMP threads per rank and -segment the products per segment
+	//of a rank instead of sizing it from the memory; -sequence writes M(k) for every k up to n,
+	//found in the same pass from the smallest table each product appears in
+	if (my_rank == 0)
+	{
+		for (i = 1; i < argc - 1; i++)
+		{
+			if (strcmp(argv[i], "-engine") == 0 && i + 1 < argc - 1)
+			{
+				i++;
+				if (strcmp(argv[i], "divisor") == 0)
+					mtOptions.engine = ENGINE_DIVISOR;
+				else if (strcmp(argv[i], "enumerate") != 0)
+					printf("Unknown engine %s, using enumerate\n", argv[i]);
+			}
+			else if (strcmp(argv[i], "-check") == 0)
+				mtOptions.check = true;
+			else if (strcmp(argv[i], "-dynamic") == 0)
+				mtOptions.dynamic = true;
+			else if (strcmp(argv[i], "-report") == 0)
+				mtOptions.report = true;
+			else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc - 1)
+				mtOptions.threads = atoi(argv[++i]);
+			else if (strcmp(argv[i], "-shared") == 0)
+				mtOptions.shared = true;
+			else if (strcmp(argv[i], "-segment") == 0 && i + 1 < argc - 1)
+				mtOptions.segment = (long long int)atof(argv[++i]);
+			else if (strcmp(argv[i], "-sequence") == 0 && i + 1 < argc - 1)
+			{
+				mtOptions.sequence = true;
+				sequencePath = argv[++i];
+			}
+			else if (strcmp(argv[i], "-format") == 0 && i + 1 < argc - 1)
+			{
+				i++;
+				if (strcmp(argv[i], "csv") == 0)
+					mtOptions.csv = true;
+				else if (strcmp(argv[i], "binary") != 0)
+					printf("Unknown format %s, using binary\n", argv[i]);
+			}
+			else
+				printf("Ignoring unknown option %s\n", argv[i]);
+		}
+		if (argc >= 2)
+		{
+			if (argv[argc - 1] != NULL)
+			{
+				n = atol(argv[argc - 1]);
+			}
+		}
+
+		//Only the enumeration sees which products each table adds
+		if (mtOptions.sequence && mtOptions.engine == ENGINE_DIVISOR)
+		{
+			printf("The sequence needs the enumerate engine, using it\n");
+			mtOptions.engine = ENGINE_ENUMERATE;
+		}
+
+		//Larger tables would overflow the divisor engine and give a wrong M(N)
+		if ((mtOptions.engine == ENGINE_DIVISOR || mtOptions.check) && n >= DIVISOR_LIMIT)
+		{
+			printf("Error: the divisor engine (-engine divisor, -check) needs n < %lld\n", DIVISOR_LIMIT);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+	}
+
+	//Broadcast n and the options to all processors
+	MPI_Bcast(&n, 1, MPI_LONG_LONG_INT, 0, MPI_COMM_WORLD);
+	MPI_Bcast(&mtOptions, sizeof(TableOptions), MPI_BYTE, 0, MPI_COMM_WORLD);
+	if (mtOptions.threads > 0)
+		omp_set_num_threads(mtOptions.threads);
+
+	if (mtOptions.sequence)
+		mtHistogram = (long long int*)calloc(n + 1, sizeof(long long int));
+
+	//Wall time, the engines may use several threads
+	double time;
+	double start, end;
+	start = MPI_Wtime();
+
+	if (mtOptions.engine == ENGINE_DIVISOR)
+		uniqueCount = divisorCount(n, my_rank, p);
+	else
+		uniqueCount = enumerateCount(n, my_rank, p);
+
 	//Stop clock 
-	end = clock();
-	time = ((double)(end - start)) / CLOCKS_PER_SEC;
+	end = MPI_Wtime();
+	time = end - start;
 	
 	double maxTimePerCPU = 0;
 
@@ -222,6 +623,55 @@ int main (int argc, char *argv[])
 		printf("M(N)/N^2: %f\n", (float)totalUniqueCount/(float)(n*n));
 	}
 
+	//Products by smallest table of all ranks in one reduction, summed up to M(k) on rank 0
+	if (mtOptions.sequence)
+	{
+		if (my_rank == 0)
+		{
+			MPI_Reduce(MPI_IN_PLACE, mtHistogram, n + 1, MPI_LONG_LONG_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+			if (writeSequence(sequencePath, mtHistogram, n))
+				printf("Sequence: M(1) .. M(%lld) in %s\n", n, sequencePath);
+		}
+		else
+			MPI_Reduce(mtHistogram, NULL, n + 1, MPI_LONG_LONG_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+		free(mtHistogram);
+	}
+
+	//Work and time of every rank
+	if (mtOptions.report)
+	{
+		double mine[4] = { (double)mtWork.segments, (double)mtWork.rows, (double)mtWork.products, time };
+		double *work = (my_rank == 0) ? (double*)malloc(4 * p * sizeof(double)) : NULL;
+		MPI_Gather(mine, 4, MPI_DOUBLE, work, 4, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		if (my_rank == 0)
+		{
+			for (i = 0; i < p; i++)
+			{
+				if (mtOptions.engine == ENGINE_DIVISOR)
+					printf("Rank %d: %.0f segments, %.0f values, %f s\n", i, work[4 * i], work[4 * i + 2], work[4 * i + 3]);
+				else
+					printf("Rank %d: %.0f segments, %.0f rows, %.0f products, %f s\n", i, work[4 * i], work[4 * i + 1],
+						work[4 * i + 2], work[4 * i + 3]);
+			}
+		}
+		free(work);
+	}
+
+	//Count again with the other engine and compare
+	if (mtOptions.check)
+	{
+		long long int checkCount = 0;
+		if (mtOptions.engine == ENGINE_DIVISOR)
+			uniqueCount = enumerateCount(n, my_rank, p);
+		else
+			uniqueCount = divisorCount(n, my_rank, p);
+		MPI_Reduce(&uniqueCount, &checkCount, 1, MPI_LONG_LONG_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+		if (my_rank == 0)
+			printf("Check: %s engine M(N): %lld, %s\n", (mtOptions.engine == ENGINE_DIVISOR) ? "enumerate" : "divisor",
+				checkCount, (checkCount == totalUniqueCount) ? "match" : "MISMATCH");
+	}
+
 	MPI_Finalize();
 	return 0;
 }
@@ -0,0 +1,64 @@
+// SE4F03 Final Project
+// Aimal Khan
+// Sean McLellan
+
+// multtable.h
+
+#ifndef MULTTABLE_H
+#define MULTTABLE_H
+
+#include <stdbool.h>
+
+//Counting engines
+#define ENGINE_ENUMERATE 0	//mark every product of the table (main.c)
+#define ENGINE_DIVISOR 1	//test every value for a divisor in range (divisors.c)
+
+//The divisor engine multiplies divisors and values up to n^3, so n must stay below this
+#define DIVISOR_LIMIT (1LL << 21)
+
+//Segments per rank, at least, when they are handed out on demand
+#define DYNAMIC_SEGMENTS 8
+
+//Pieces per thread a segment is split in for clearing and counting, at least
+#define THREAD_PIECES 8
+
+//Rows a thread marks at a time, across the whole segment
+#define ROW_BLOCK 64
+
+//Segments get 1/CACHE_SHARE of the L2 cache, at most 1/SEGMENT_SHARE of the memory of a node,
+//less BUFFER MB per rank
+#define CACHE_SHARE 2
+#define SEGMENT_SHARE 2
+#define BUFFER 20
+
+//L2 cache size when the system does not tell
+#define DEFAULT_CACHE (1024 * 1024)
+
+typedef struct
+{
+	int engine;		//ENGINE_ENUMERATE or ENGINE_DIVISOR (-engine)
+	bool check;		//count again with the other engine (-check)
+	bool dynamic;		//ranks claim segments from a shared counter (-dynamic)
+	bool report;		//print the work and time of every rank (-report)
+	int threads;		//OpenMP threads per rank (-threads); 0 for the OpenMP default
+	long long int segment;	//products per segment of a rank (-segment); 0 to size it from the memory
+	bool shared;		//the ranks of a node share one segment bitmap (-shared)
+	bool sequence;		//M(k) for every k up to n as well (-sequence)
+	bool csv;		//the sequence as text instead of binary (-format)
+} TableOptions;
+
+//Work of this rank in the last count
+typedef struct
+{
+	long long int segments;	//segments done
+	long long int rows;	//rows walked by the enumeration, once per segment they have products in
+	long long int products;	//products marked, or values tested by the divisor engine
+} TableWork;
+
+extern TableOptions mtOptions;
+extern TableWork mtWork;
+extern long long int *mtHistogram;
+
+long long int divisorCount(long long int n, int my_rank, int p);
+
+#endif